@@ -0,0 +1,269 @@
+//
+// Burrows-Wheeler transform of the counts stream, in linear time with SA-IS
+//MOD
+//
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+#include "BWT.h"
+
+/**
+ * Suffix array by induced sorting (Nong, Zhang and Chan, 2009)
+ * @param T the text, T[n - 1] must be the only 0
+ * @param SA the suffix array is returned here (n entries)
+ * @param n the text length
+ * @param K the alphabet size: every T[i] < K
+ */
+template<typename char_t, typename index_t>
+static void sais(const char_t *T, index_t *SA, size_t n, size_t K){
+    const index_t EMPTY = (index_t) -1;
+
+    // S-type suffixes are smaller than the next one
+    vector<bool> stype(n);
+    stype[n - 1] = true;
+    for(size_t i = n - 1; i-- > 0;)
+        stype[i] = T[i] < T[i + 1] || (T[i] == T[i + 1] && stype[i + 1]);
+    auto is_lms = [&stype](size_t i){ return i > 0 && stype[i] && !stype[i - 1]; };
+
+    vector<index_t> symbol_count(K, 0), bucket(K);
+    for(size_t i = 0; i < n; i++)
+        symbol_count[T[i]]++;
+    auto set_buckets = [&](bool ends){
+        index_t sum = 0;
+        for(size_t c = 0; c < K; c++){
+            sum += symbol_count[c];
+            bucket[c] = ends ? sum : sum - symbol_count[c];
+        }
+    };
+    auto induce = [&](){
+        set_buckets(false);
+        for(size_t i = 0; i < n; i++){
+            index_t s = SA[i];
+            if(s != EMPTY && s > 0 && !stype[s - 1])
+                SA[bucket[T[s - 1]]++] = s - 1;
+        }
+        set_buckets(true);
+        for(size_t i = n; i-- > 0;){
+            index_t s = SA[i];
+            if(s != EMPTY && s > 0 && stype[s - 1])
+                SA[--bucket[T[s - 1]]] = s - 1;
+        }
+    };
+
+    // sort the LMS substrings
+    fill(SA, SA + n, EMPTY);
+    set_buckets(true);
+    for(size_t i = 1; i < n; i++)
+        if(is_lms(i))
+            SA[--bucket[T[i]]] = i;
+    induce();
+
+    size_t n1 = 0;
+    for(size_t i = 0; i < n; i++)
+        if(is_lms(SA[i]))
+            SA[n1++] = SA[i];
+
+    // name them: equal LMS substrings get the same name
+    fill(SA + n1, SA + n, EMPTY);
+    size_t n_names = 0;
+    size_t prev = n;
+    for(size_t i = 0; i < n1; i++){
+        size_t pos = SA[i];
+        bool differ = prev == n;
+        for(size_t d = 0; !differ; d++){
+            if(T[pos + d] != T[prev + d] || stype[pos + d] != stype[prev + d])
+                differ = true;
+            else if(d > 0 && (is_lms(pos + d) || is_lms(prev + d)))
+                break;
+        }
+        if(differ){
+            n_names++;
+            prev = pos;
+        }
+        SA[n1 + pos / 2] = n_names - 1;
+    }
+    for(size_t i = n, j = n; i-- > n1;)
+        if(SA[i] != EMPTY)
+            SA[--j] = SA[i];
+
+    // sort the LMS suffixes, recursing on the names if they are not unique
+    index_t *reduced = SA + n - n1;
+    if(n_names < n1)
+        sais<index_t, index_t>(reduced, SA, n1, n_names);
+    else
+        for(size_t i = 0; i < n1; i++)
+            SA[reduced[i]] = i;
+
+    // induce all suffixes from the sorted LMS suffixes
+    for(size_t i = 1, j = 0; i < n; i++)
+        if(is_lms(i))
+            reduced[j++] = i;
+    for(size_t i = 0; i < n1; i++)
+        SA[i] = reduced[SA[i]];
+    fill(SA + n1, SA + n, EMPTY);
+    set_buckets(true);
+    for(size_t i = n1; i-- > 0;){
+        index_t j = SA[i];
+        SA[i] = EMPTY;
+        SA[--bucket[T[j]]] = j;
+    }
+    induce();
+}
+
+/**
+ * Replace symbols with their rank among the distinct symbols, starting from 1
+ * @return the number of distinct symbols + 1
+ */
+static size_t rank_symbols(const uint32_t *text, size_t n, uint32_t *ranked){
+    uint32_t max_symbol = *max_element(text, text + n);
+
+    // small alphabets (counts usually are) use a table, large ones a sorted copy
+    if((size_t) max_symbol <= n + (1 << 16)){
+        vector<uint32_t> rank(max_symbol + 1, 0);
+        for(size_t i = 0; i < n; i++)
+            rank[text[i]] = 1;
+        uint32_t n_symbols = 0;
+        for(uint32_t &r : rank)
+            r = r ? ++n_symbols : 0;
+        for(size_t i = 0; i < n; i++)
+            ranked[i] = rank[text[i]];
+        return n_symbols + 1;
+    }
+
+    vector<uint32_t> alphabet(text, text + n);
+    sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(unique(alphabet.begin(), alphabet.end()), alphabet.end());
+    for(size_t i = 0; i < n; i++)
+        ranked[i] = lower_bound(alphabet.begin(), alphabet.end(), text[i]) - alphabet.begin() + 1;
+    return alphabet.size() + 1;
+}
+
+template<typename index_t>
+static uint64_t transform(const uint32_t *text, size_t n, uint32_t *bwt){
+    // the sentinel is an explicit 0
+    vector<uint32_t> ranked(n + 1);
+    size_t n_symbols = rank_symbols(text, n, ranked.data());
+    ranked[n] = 0;
+
+    vector<index_t> SA(n + 1);
+    sais<uint32_t, index_t>(ranked.data(), SA.data(), n + 1, n_symbols);
+    vector<uint32_t>().swap(ranked);
+
+    uint64_t primary_index = 0;
+    for(size_t i = 0, out = 0; i <= n; i++){
+        if(SA[i] == 0){
+            primary_index = i;
+            continue;
+        }
+        bwt[out++] = text[SA[i] - 1];
+    }
+    return primary_index;
+}
+
+static uint64_t transform(const uint32_t *text, size_t n, uint32_t *bwt){
+    if(n == 0)
+        return 0;
+    // 32 bit suffix arrays while they fit (UINT32_MAX marks empty slots)
+    if(n + 1 < UINT32_MAX)
+        return transform<uint32_t>(text, n, bwt);
+    return transform<uint64_t>(text, n, bwt);
+}
+
+template<typename index_t>
+static void inverse(const uint32_t *bwt, size_t n, uint64_t primary_index, uint32_t *text){
+    vector<uint32_t> ranked(n);
+    size_t n_symbols = rank_symbols(bwt, n, ranked.data());
+
+    // first row of each symbol, the sentinel row is the first one
+    vector<index_t> next_row(n_symbols, 0);
+    for(size_t i = 0; i < n; i++)
+        next_row[ranked[i]]++;
+    index_t sum = 1;
+    for(size_t c = 1; c < n_symbols; c++){
+        index_t count = next_row[c];
+        next_row[c] = sum;
+        sum += count;
+    }
+
+    // LF mapping of the n + 1 rows, the sentinel is in row primary_index
+    vector<index_t> lf(n + 1);
+    for(size_t row = 0; row <= n; row++){
+        if(row == primary_index)
+            lf[row] = 0;
+        else
+            lf[row] = next_row[ranked[row - (row > primary_index)]]++;
+    }
+    vector<uint32_t>().swap(ranked);
+
+    // row 0 starts with the sentinel: its last symbol is the last one of the text
+    size_t row = 0;
+    for(size_t i = n; i-- > 0;){
+        text[i] = bwt[row - (row > primary_index)];
+        row = lf[row];
+    }
+}
+
+static void inverse(const uint32_t *bwt, size_t n, uint64_t primary_index, uint32_t *text){
+    if(n == 0)
+        return;
+    if(primary_index == 0 || primary_index > n){
+        cerr << "bwt_inverse(): Bad primary index " << primary_index << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(n + 1 < UINT32_MAX)
+        inverse<uint32_t>(bwt, n, primary_index, text);
+    else
+        inverse<uint64_t>(bwt, n, primary_index, text);
+}
+
+uint64_t bwt_transform(const vector<uint32_t> &text, vector<uint32_t> &bwt){
+    bwt.resize(text.size());
+    return transform(text.data(), text.size(), bwt.data());
+}
+
+void bwt_transform_blocks(const vector<uint32_t> &text, size_t block_size, vector<uint32_t> &bwt,
+                          vector<uint64_t> &primary_indices, unsigned n_threads){
+    if(block_size == 0)
+        block_size = max((size_t) 1, text.size());
+    size_t n_blocks = (text.size() + block_size - 1) / block_size;
+    bwt.resize(text.size());
+    primary_indices.assign(n_blocks, 0);
+
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    atomic<size_t> next_block{0};
+    auto worker = [&](){
+        for(size_t b = next_block++; b < n_blocks; b = next_block++){
+            size_t begin = b * block_size;
+            size_t length = min(block_size, text.size() - begin);
+            primary_indices[b] = transform(text.data() + begin, length, bwt.data() + begin);
+        }
+    };
+    vector<thread> threads;
+    for(unsigned t = 1; t < min((size_t) n_threads, n_blocks); t++)
+        threads.emplace_back(worker);
+    worker();
+    for(auto &th : threads)
+        th.join();
+}
+
+void bwt_inverse(const vector<uint32_t> &bwt, uint64_t primary_index, vector<uint32_t> &text){
+    text.resize(bwt.size());
+    inverse(bwt.data(), bwt.size(), primary_index, text.data());
+}
+
+void bwt_inverse_blocks(const vector<uint32_t> &bwt, size_t block_size, const vector<uint64_t> &primary_indices,
+                        vector<uint32_t> &text){
+    if(block_size == 0)
+        block_size = max((size_t) 1, bwt.size());
+    text.resize(bwt.size());
+    for(size_t b = 0; b < primary_indices.size(); b++){
+        size_t begin = b * block_size;
+        size_t length = min(block_size, bwt.size() - begin);
+        inverse(bwt.data() + begin, length, primary_indices[b], text.data() + begin);
+    }
+}
@@ -0,0 +1,55 @@
+//
+// Burrows-Wheeler transform of the counts stream, in linear time with SA-IS
+//MOD
+//
+
+#ifndef USTAR_BWT_H
+#define USTAR_BWT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Burrows-Wheeler transform of a text of any uint32_t symbols.
+ * The suffix array is built by induced sorting (SA-IS): linear time, 4 bytes per symbol (8 above 4G symbols).
+ * The text ends with a virtual sentinel smaller than every symbol; it's not written in bwt, the primary index tells where it would be.
+ * @param text the text
+ * @param bwt the transformed text, as long as text
+ * @return the primary index (between 1 and the text length, 0 for an empty text)
+ */
+uint64_t bwt_transform(const vector<uint32_t> &text, vector<uint32_t> &bwt);
+
+/**
+ * Memory-bounded variant of bwt_transform(): blocks of block_size symbols are transformed independently and in parallel.
+ * Besides text and bwt, every thread needs about 8 bytes per block symbol.
+ * @param text the text
+ * @param block_size symbols per block (the last block may be shorter)
+ * @param bwt the transformed blocks, one after the other
+ * @param primary_indices the primary index of each block
+ * @param n_threads number of threads (0 means one per hardware thread)
+ */
+void bwt_transform_blocks(const vector<uint32_t> &text, size_t block_size, vector<uint32_t> &bwt,
+                          vector<uint64_t> &primary_indices, unsigned n_threads=0);
+
+/**
+ * Invert bwt_transform()
+ * @param bwt the transformed text
+ * @param primary_index the primary index returned by bwt_transform()
+ * @param text the original text
+ */
+void bwt_inverse(const vector<uint32_t> &bwt, uint64_t primary_index, vector<uint32_t> &text);
+
+/**
+ * Invert bwt_transform_blocks()
+ * @param bwt the transformed blocks
+ * @param block_size symbols per block
+ * @param primary_indices the primary index of each block
+ * @param text the original text
+ */
+void bwt_inverse_blocks(const vector<uint32_t> &bwt, size_t block_size, const vector<uint64_t> &primary_indices,
+                        vector<uint32_t> &text);
+
+#endif //USTAR_BWT_H
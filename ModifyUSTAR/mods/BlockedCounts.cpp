@@ -0,0 +1,322 @@
+//
+// Block-indexed counts file: the counts of any k-mer or simplitig decode without reading the rest of the file
+//MOD
+//
+
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "BlockedCounts.h"
+#include "Entropy.h"
+#include "FastWriter.h"
+
+static const char MAGIC[4] = {'U', 'S', 'T', 'B'};
+static const uint32_t VERSION = 1;
+static const uint32_t FLAG_RLE = 1;
+
+struct blocked_header_t{
+    char magic[4];
+    uint32_t version;
+    uint32_t encoding;
+    uint32_t flags;
+    uint32_t block_kmers;
+    uint32_t reserved;
+    uint64_t n_kmers;
+    uint64_t n_simplitigs;
+    uint64_t n_blocks;
+    uint64_t lengths_size; // rANS coded simplitig lengths follow, then the directory at the next multiple of 8
+};
+
+template<typename T>
+static void append_raw(string &out, T value){
+    out.append((const char *) &value, sizeof(T));
+}
+
+void write_blocked_counts(const string &file_name, const vector<uint32_t> &symbols, const vector<uint32_t> &runs,
+                          const vector<uint32_t> &counts, const vector<uint32_t> &simplitig_lengths, uint32_t encoding,
+                          uint32_t block_kmers, unsigned n_threads){
+    bool rle = !symbols.empty();
+    uint64_t n_kmers = 0;
+    if(rle)
+        for(uint32_t run : runs)
+            n_kmers += run;
+    else
+        n_kmers = counts.size();
+
+    uint64_t n_simplitig_kmers = 0;
+    for(uint32_t length : simplitig_lengths)
+        n_simplitig_kmers += length;
+    if(symbols.size() != runs.size() || n_simplitig_kmers != n_kmers || block_kmers == 0){
+        cerr << "write_blocked_counts(): The counts don't match the simplitigs" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // where each block starts: run index and k-mers of that run already in the previous block
+    uint64_t n_blocks = (n_kmers + block_kmers - 1) / block_kmers;
+    vector<size_t> first_run(n_blocks, 0);
+    vector<uint32_t> first_run_offset(n_blocks, 0);
+    if(rle){
+        size_t r = 0;
+        uint64_t run_rank = 0;
+        for(uint64_t b = 0; b < n_blocks; b++){
+            uint64_t rank = b * block_kmers;
+            while(run_rank + runs[r] <= rank)
+                run_rank += runs[r++];
+            first_run[b] = r;
+            first_run_offset[b] = (uint32_t) (rank - run_rank);
+        }
+    }
+
+    // blocks are coded independently
+    vector<string> payloads(n_blocks);
+    vector<counts_block_entry_t> directory(n_blocks);
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    atomic<uint64_t> next_block{0};
+    auto worker = [&](){
+        vector<uint32_t> block_symbols, block_runs;
+        for(uint64_t b = next_block++; b < n_blocks; b = next_block++){
+            uint64_t first_rank = b * block_kmers;
+            uint64_t length = min((uint64_t) block_kmers, n_kmers - first_rank);
+            directory[b] = {first_rank, 0, 0, 0};
+            if(!rle){
+                rans_encode(counts.data() + first_rank, length, payloads[b]);
+                continue;
+            }
+
+            block_symbols.clear();
+            block_runs.clear();
+            uint64_t left = length;
+            for(size_t r = first_run[b]; left > 0; r++){
+                uint64_t run = runs[r] - (r == first_run[b] ? first_run_offset[b] : 0);
+                run = min(run, left);
+                block_symbols.push_back(symbols[r]);
+                block_runs.push_back((uint32_t) run);
+                left -= run;
+            }
+            string coded_symbols;
+            rans_encode(block_symbols.data(), block_symbols.size(), coded_symbols);
+            append_raw(payloads[b], (uint32_t) coded_symbols.size());
+            payloads[b].append(coded_symbols);
+            rans_encode(block_runs.data(), block_runs.size(), payloads[b]);
+            directory[b].n_runs = (uint32_t) block_runs.size();
+        }
+    };
+    vector<thread> threads;
+    for(unsigned t = 1; t < min((uint64_t) n_threads, max((uint64_t) 1, n_blocks)); t++)
+        threads.emplace_back(worker);
+    worker();
+    for(auto &th : threads)
+        th.join();
+
+    string coded_lengths;
+    rans_encode(simplitig_lengths.data(), simplitig_lengths.size(), coded_lengths);
+
+    blocked_header_t header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.encoding = encoding;
+    header.flags = rle ? FLAG_RLE : 0;
+    header.block_kmers = block_kmers;
+    header.n_kmers = n_kmers;
+    header.n_simplitigs = simplitig_lengths.size();
+    header.n_blocks = n_blocks;
+    header.lengths_size = coded_lengths.size();
+    coded_lengths.resize((coded_lengths.size() + 7) / 8 * 8, '\0'); // the directory is read in place
+
+    uint64_t offset = sizeof(header) + coded_lengths.size() + n_blocks * sizeof(counts_block_entry_t);
+    for(uint64_t b = 0; b < n_blocks; b++){
+        directory[b].offset = offset;
+        directory[b].size = (uint32_t) payloads[b].size();
+        offset += payloads[b].size();
+    }
+
+    FastWriter out_file(file_name);
+    string &buffer = out_file.get_buffer();
+    append_raw(buffer, header);
+    buffer.append(coded_lengths);
+    out_file.write((const char *) directory.data(), directory.size() * sizeof(counts_block_entry_t));
+    for(const string &payload : payloads){
+        buffer.append(payload);
+        out_file.commit();
+    }
+}
+
+BlockedCountsReader::BlockedCountsReader(const string &file_name) : blocked_file(file_name, false) {
+    // is_good stays false until every check passed
+    if(!blocked_file.good()){
+        cerr << "BlockedCountsReader(): Can't map file " << file_name << endl;
+        return;
+    }
+    blocked_header_t header{};
+    uint64_t file_size = blocked_file.size();
+    if(file_size < sizeof(header) || memcmp(blocked_file.data(), MAGIC, sizeof(MAGIC)) != 0){
+        cerr << "BlockedCountsReader(): " << file_name << " is not a blocked counts file" << endl;
+        return;
+    }
+    memcpy(&header, blocked_file.data(), sizeof(header));
+    if(header.version != VERSION){
+        cerr << "BlockedCountsReader(): Unknown version of " << file_name << endl;
+        return;
+    }
+
+    // sizes and counts are checked against the file before anything is allocated
+    if(header.lengths_size > file_size - sizeof(header)
+       || (header.lengths_size + 7) / 8 * 8 > file_size - sizeof(header)){
+        cerr << "BlockedCountsReader(): Truncated file " << file_name << endl;
+        return;
+    }
+    uint64_t directory_offset = sizeof(header) + (header.lengths_size + 7) / 8 * 8;
+    if(header.n_blocks > (file_size - directory_offset) / sizeof(counts_block_entry_t)){
+        cerr << "BlockedCountsReader(): Truncated file " << file_name << endl;
+        return;
+    }
+    if(header.block_kmers == 0
+       || header.n_blocks != header.n_kmers / header.block_kmers + (header.n_kmers % header.block_kmers != 0)){
+        cerr << "BlockedCountsReader(): The blocks don't match the k-mers in " << file_name << endl;
+        return;
+    }
+    const char *coded_lengths = blocked_file.data() + sizeof(header);
+    if(header.n_simplitigs > header.n_kmers
+       || header.n_simplitigs > rans_max_values(coded_lengths, header.lengths_size)){
+        cerr << "BlockedCountsReader(): Corrupted simplitig lengths in " << file_name << endl;
+        return;
+    }
+
+    const counts_block_entry_t *entries = (const counts_block_entry_t *) (blocked_file.data() + directory_offset);
+    for(uint64_t b = 0; b < header.n_blocks; b++){
+        const counts_block_entry_t &entry = entries[b];
+        if(entry.offset > file_size || entry.size > file_size - entry.offset){
+            cerr << "BlockedCountsReader(): Truncated file " << file_name << endl;
+            return;
+        }
+        // every run holds one k-mer at least
+        if(entry.first_rank != b * header.block_kmers || entry.n_runs > header.block_kmers){
+            cerr << "BlockedCountsReader(): Corrupted directory in " << file_name << endl;
+            return;
+        }
+    }
+
+    simplitig_lengths.resize(header.n_simplitigs);
+    if(!rans_decode(coded_lengths, header.lengths_size, header.n_simplitigs, simplitig_lengths.data())){
+        cerr << "BlockedCountsReader(): Corrupted simplitig lengths in " << file_name << endl;
+        return;
+    }
+    uint64_t rank = 0;
+    for(size_t i = 0; i < simplitig_lengths.size(); i++){
+        if(i % PREFIX_SAMPLING == 0)
+            sampled_ranks.push_back(rank);
+        rank += simplitig_lengths[i];
+    }
+    if(rank != header.n_kmers){
+        cerr << "BlockedCountsReader(): Simplitig lengths don't match the counts in " << file_name << endl;
+        return;
+    }
+
+    rle = header.flags & FLAG_RLE;
+    encoding = header.encoding;
+    block_kmers = header.block_kmers;
+    n_kmers = header.n_kmers;
+    n_blocks = header.n_blocks;
+    directory = entries;
+    is_good = true;
+}
+
+void BlockedCountsReader::load_block(uint64_t block) const {
+    if(block == cached_block)
+        return;
+    if(block >= n_blocks){
+        cerr << "BlockedCountsReader: k-mer rank out of range" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const counts_block_entry_t &entry = directory[block];
+    const char *payload = blocked_file.data() + entry.offset;
+    uint64_t length = min((uint64_t) block_kmers, n_kmers - entry.first_rank);
+    block_counts.resize(length);
+
+    bool good;
+    if(!rle)
+        good = rans_decode(payload, entry.size, length, block_counts.data());
+    else {
+        uint32_t symbols_size;
+        memcpy(&symbols_size, payload, sizeof(uint32_t));
+        vector<uint32_t> symbols(entry.n_runs), runs(entry.n_runs);
+        good = sizeof(uint32_t) + (uint64_t) symbols_size <= entry.size
+               && rans_decode(payload + sizeof(uint32_t), symbols_size, entry.n_runs, symbols.data())
+               && rans_decode(payload + sizeof(uint32_t) + symbols_size, entry.size - sizeof(uint32_t) - symbols_size, entry.n_runs, runs.data());
+        uint64_t k = 0;
+        for(size_t r = 0; good && r < entry.n_runs; r++){
+            good = k + runs[r] <= length;
+            if(good)
+                fill(block_counts.begin() + (long) k, block_counts.begin() + (long) (k + runs[r]), symbols[r]);
+            k += runs[r];
+        }
+        good = good && k == length;
+    }
+    if(!good){
+        cerr << "BlockedCountsReader: Corrupted block " << block << endl;
+        exit(EXIT_FAILURE);
+    }
+    cached_block = block;
+}
+
+bool BlockedCountsReader::good() const {
+    return is_good;
+}
+
+uint32_t BlockedCountsReader::get_encoding() const {
+    return encoding;
+}
+
+uint64_t BlockedCountsReader::get_n_kmers() const {
+    return n_kmers;
+}
+
+size_t BlockedCountsReader::get_n_simplitigs() const {
+    return simplitig_lengths.size();
+}
+
+uint32_t BlockedCountsReader::get_count(uint64_t rank) const {
+    if(rank >= n_kmers){
+        cerr << "BlockedCountsReader::get_count(): K-mer rank " << rank << " out of range" << endl;
+        exit(EXIT_FAILURE);
+    }
+    load_block(rank / block_kmers);
+    return block_counts[rank % block_kmers];
+}
+
+void BlockedCountsReader::get_counts(uint64_t first_rank, uint64_t n, vector<uint32_t> &counts) const {
+    if(n > n_kmers || first_rank > n_kmers - n){
+        cerr << "BlockedCountsReader::get_counts(): K-mer ranks " << first_rank << " + " << n << " out of range" << endl;
+        exit(EXIT_FAILURE);
+    }
+    counts.clear();
+    counts.reserve(n);
+    for(uint64_t rank = first_rank; rank < first_rank + n;){
+        load_block(rank / block_kmers);
+        uint64_t in_block = rank % block_kmers;
+        uint64_t taken = min(n - (rank - first_rank), block_counts.size() - in_block);
+        counts.insert(counts.end(), block_counts.begin() + (long) in_block, block_counts.begin() + (long) (in_block + taken));
+        rank += taken;
+    }
+}
+
+uint64_t BlockedCountsReader::get_first_rank(size_t simplitig) const {
+    if(simplitig >= simplitig_lengths.size()){
+        cerr << "BlockedCountsReader::get_first_rank(): Simplitig " << simplitig << " out of range" << endl;
+        exit(EXIT_FAILURE);
+    }
+    uint64_t rank = sampled_ranks.at(simplitig / PREFIX_SAMPLING);
+    for(size_t i = simplitig / PREFIX_SAMPLING * PREFIX_SAMPLING; i < simplitig; i++)
+        rank += simplitig_lengths[i];
+    return rank;
+}
+
+void BlockedCountsReader::get_simplitig_counts(size_t simplitig, vector<uint32_t> &counts) const {
+    uint64_t first_rank = get_first_rank(simplitig); // checks simplitig
+    get_counts(first_rank, simplitig_lengths[simplitig], counts);
+}
@@ -0,0 +1,113 @@
+//
+// Block-indexed counts file: the counts of any k-mer or simplitig decode without reading the rest of the file
+//MOD
+//
+
+#ifndef USTAR_BLOCKEDCOUNTS_H
+#define USTAR_BLOCKEDCOUNTS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.h"
+
+using namespace std;
+
+/**
+ * Write a block-indexed counts file.
+ * The counts stream is cut in blocks of block_kmers k-mers, each coded on its own with rANS (runs crossing a block
+ * boundary are split), and a directory gives the first k-mer rank and file offset of every block.
+ * @param file_name the output file
+ * @param symbols run symbols (RLE encodings), or empty
+ * @param runs run lengths, same size as symbols
+ * @param counts the counts when symbols is empty
+ * @param simplitig_lengths k-mers of each simplitig, in output order
+ * @param encoding the encoding_t of the Encoder
+ * @param block_kmers k-mers per block
+ * @param n_threads number of threads coding blocks (0 means one per hardware thread)
+ */
+void write_blocked_counts(const string &file_name, const vector<uint32_t> &symbols, const vector<uint32_t> &runs,
+                          const vector<uint32_t> &counts, const vector<uint32_t> &simplitig_lengths, uint32_t encoding,
+                          uint32_t block_kmers=1 << 16, unsigned n_threads=0);
+
+struct counts_block_entry_t{
+    uint64_t first_rank;    // rank of the first k-mer of the block
+    uint64_t offset;        // where the block starts in the file
+    uint32_t n_runs;        // runs in the block (0 for plain counts)
+    uint32_t size;          // bytes
+};
+
+/**
+ * Random access to a file written by write_blocked_counts(), through a memory mapping.
+ * The last decoded block is cached: an instance must not be shared by threads.
+ */
+class BlockedCountsReader{
+    static const uint64_t PREFIX_SAMPLING = 64;
+
+    MappedFile blocked_file;
+    bool is_good = false;
+    bool rle = false;
+    uint32_t encoding = 0;
+    uint32_t block_kmers = 0;
+    uint64_t n_kmers = 0;
+    const counts_block_entry_t *directory = nullptr;
+    uint64_t n_blocks = 0;
+
+    vector<uint32_t> simplitig_lengths;
+    vector<uint64_t> sampled_ranks; // rank of the first k-mer of every PREFIX_SAMPLING-th simplitig
+
+    mutable uint64_t cached_block = UINT64_MAX;
+    mutable vector<uint32_t> block_counts;
+
+    /**
+     * Decode a block into block_counts, unless it's the cached one
+     */
+    void load_block(uint64_t block) const;
+
+public:
+    /**
+     * Map a blocked counts file and read its directory
+     * @param file_name the file
+     */
+    explicit BlockedCountsReader(const string &file_name);
+
+    /**
+     * @return false if the file can't be read or is corrupted (the reason is printed)
+     */
+    bool good() const;
+
+    uint32_t get_encoding() const;
+
+    uint64_t get_n_kmers() const;
+
+    size_t get_n_simplitigs() const;
+
+    /**
+     * @param rank k-mer rank in output order
+     * @return its count
+     */
+    uint32_t get_count(uint64_t rank) const;
+
+    /**
+     * Decode the counts of consecutive k-mers
+     * @param first_rank the rank of the first k-mer
+     * @param n how many k-mers
+     * @param counts counts are returned here
+     */
+    void get_counts(uint64_t first_rank, uint64_t n, vector<uint32_t> &counts) const;
+
+    /**
+     * @param simplitig simplitig index in output order
+     * @return the rank of its first k-mer
+     */
+    uint64_t get_first_rank(size_t simplitig) const;
+
+    /**
+     * Decode the counts of a simplitig
+     * @param simplitig simplitig index in output order
+     * @param counts counts are returned here
+     */
+    void get_simplitig_counts(size_t simplitig, vector<uint32_t> &counts) const;
+};
+
+#endif //USTAR_BLOCKEDCOUNTS_H
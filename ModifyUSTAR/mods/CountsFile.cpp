@@ -0,0 +1,229 @@
+//
+// Binary .counts container: the streams produced by the Encoder, each with its own codec
+//MOD
+//
+
+#include <iostream>
+#include <cstring>
+
+#include "consts.h"
+#include "CountsFile.h"
+#include "Entropy.h"
+#include "IntCodecs.h"
+#include "BWT.h"
+#include "MappedFile.h"
+#include "FastWriter.h"
+
+static const char MAGIC[4] = {'U', 'S', 'T', 'C'};
+static const uint32_t VERSION = 2; // 1 had no quantization bound
+
+enum stream_id_t : uint8_t{
+    SYMBOLS = 0,
+    RUNS = 1,
+    COUNTS = 2
+};
+
+template<typename T>
+static void append_raw(string &out, T value){
+    out.append((const char *) &value, sizeof(T));
+}
+
+template<typename T>
+static bool read_raw(const char *&p, const char *end, T &value){
+    if((size_t) (end - p) < sizeof(T))
+        return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool parse_stream_codec(const string &name, stream_codec_t &codec){
+    static const char *names[] = {"raw", "rans", "varint", "stream-vbyte", "for"};
+    for(uint8_t c = 0; c < sizeof(names) / sizeof(names[0]); c++)
+        if(name == names[c]){
+            codec = (stream_codec_t) c;
+            return true;
+        }
+    return false;
+}
+
+void encode_stream(const vector<uint32_t> &values, stream_codec_t codec, string &payload){
+    switch(codec){
+        case stream_codec_t::RAW:
+            payload.append((const char *) values.data(), values.size() * sizeof(uint32_t));
+            break;
+        case stream_codec_t::RANS:
+            rans_encode(values.data(), values.size(), payload);
+            break;
+        case stream_codec_t::VARINT:
+            varint_encode(values.data(), values.size(), payload);
+            break;
+        case stream_codec_t::STREAM_VBYTE:
+            stream_vbyte_encode(values.data(), values.size(), payload);
+            break;
+        case stream_codec_t::FOR:
+            for_encode(values.data(), values.size(), payload);
+            break;
+    }
+}
+
+/**
+ * @return how many values a payload coded with codec can hold at most (SIZE_MAX when it can't be bounded)
+ */
+static size_t max_stream_values(const char *payload, size_t size, stream_codec_t codec){
+    switch(codec){
+        case stream_codec_t::RAW:
+            return size / sizeof(uint32_t);
+        case stream_codec_t::RANS:
+            return rans_max_values(payload, size);
+        case stream_codec_t::VARINT:
+        case stream_codec_t::STREAM_VBYTE:
+            return size; // at least a byte per value
+        case stream_codec_t::FOR:
+            return for_max_values(size);
+    }
+    return 0;
+}
+
+bool decode_stream(const char *payload, size_t size, stream_codec_t codec, size_t n_values, vector<uint32_t> &values){
+    // a corrupted count must not reach the allocation
+    if(n_values > max_stream_values(payload, size, codec))
+        return false;
+    values.resize(n_values);
+    switch(codec){
+        case stream_codec_t::RAW:
+            if(size != n_values * sizeof(uint32_t))
+                return false;
+            memcpy(values.data(), payload, size);
+            return true;
+        case stream_codec_t::RANS:
+            return rans_decode(payload, size, n_values, values.data());
+        case stream_codec_t::VARINT:
+            return varint_decode(payload, size, n_values, values.data());
+        case stream_codec_t::STREAM_VBYTE:
+            return stream_vbyte_decode(payload, size, n_values, values.data());
+        case stream_codec_t::FOR:
+            return for_decode(payload, size, n_values, values.data());
+    }
+    return false;
+}
+
+static void write_stream(FastWriter &out_file, stream_id_t id, const vector<uint32_t> &values, stream_codec_t codec){
+    if(values.empty())
+        return;
+
+    // raw values are written from the vector, without a copy
+    string payload;
+    const char *data = (const char *) values.data();
+    size_t size = values.size() * sizeof(uint32_t);
+    if(codec != stream_codec_t::RAW){
+        encode_stream(values, codec, payload);
+        data = payload.data();
+        size = payload.size();
+    }
+
+    string &buffer = out_file.get_buffer();
+    append_raw(buffer, (uint8_t) id);
+    append_raw(buffer, (uint8_t) codec);
+    append_raw(buffer, (uint64_t) values.size());
+    append_raw(buffer, (uint64_t) size);
+    out_file.write(data, size);
+}
+
+void write_counts_container(const string &file_name, const counts_container_t &container, stream_codec_t codec){
+    FastWriter out_file(file_name);
+    string &buffer = out_file.get_buffer();
+    buffer.append(MAGIC, sizeof(MAGIC));
+    append_raw(buffer, VERSION);
+    append_raw(buffer, container.encoding);
+    append_raw(buffer, container.quantization_bound);
+    append_raw(buffer, container.bwt_block_size);
+    append_raw(buffer, (uint64_t) container.bwt_primary_indices.size());
+    for(uint64_t primary_index : container.bwt_primary_indices)
+        append_raw(buffer, primary_index);
+
+    write_stream(out_file, SYMBOLS, container.symbols, codec);
+    write_stream(out_file, RUNS, container.runs, codec);
+    write_stream(out_file, COUNTS, container.counts, codec);
+}
+
+bool read_counts_container(const string &file_name, counts_container_t &container){
+    MappedFile in_file(file_name);
+    if(!in_file.good()){
+        cerr << "read_counts_container(): Can't map file " << file_name << endl;
+        return false;
+    }
+    const char *p = in_file.data(), *end = p + in_file.size();
+
+    uint32_t version;
+    uint64_t n_blocks;
+    if(in_file.size() < sizeof(MAGIC) || memcmp(p, MAGIC, sizeof(MAGIC)) != 0){
+        cerr << "read_counts_container(): " << file_name << " is not a binary counts file" << endl;
+        return false;
+    }
+    p += sizeof(MAGIC);
+    if(!read_raw(p, end, version) || version == 0 || version > VERSION){
+        cerr << "read_counts_container(): Unknown version of " << file_name << endl;
+        return false;
+    }
+    container.quantization_bound = 0;
+    if(!read_raw(p, end, container.encoding) || (version >= 2 && !read_raw(p, end, container.quantization_bound))
+       || !read_raw(p, end, container.bwt_block_size) || !read_raw(p, end, n_blocks)
+       || n_blocks > (uint64_t) (end - p) / sizeof(uint64_t)){
+        cerr << "read_counts_container(): Truncated header in " << file_name << endl;
+        return false;
+    }
+    container.bwt_primary_indices.resize(n_blocks);
+    for(uint64_t &primary_index : container.bwt_primary_indices)
+        read_raw(p, end, primary_index);
+
+    container.symbols.clear();
+    container.runs.clear();
+    container.counts.clear();
+    while(p < end){
+        uint8_t id, codec;
+        uint64_t n_values, payload_size;
+        if(!read_raw(p, end, id) || !read_raw(p, end, codec) || !read_raw(p, end, n_values) || !read_raw(p, end, payload_size)
+           || payload_size > (uint64_t) (end - p) || id > COUNTS){
+            cerr << "read_counts_container(): Bad stream header in " << file_name << endl;
+            return false;
+        }
+        vector<uint32_t> &values = id == SYMBOLS ? container.symbols : (id == RUNS ? container.runs : container.counts);
+        // there is a run per symbol, written after them: this also bounds runs of a single length, which rANS codes
+        // in no space
+        if(id == RUNS && n_values != container.symbols.size()){
+            cerr << "read_counts_container(): Symbols and runs differ in number in " << file_name << endl;
+            return false;
+        }
+        if(codec > (uint8_t) stream_codec_t::FOR || !decode_stream(p, payload_size, (stream_codec_t) codec, n_values, values)){
+            cerr << "read_counts_container(): Corrupted stream in " << file_name << endl;
+            return false;
+        }
+        p += payload_size;
+    }
+    if(container.symbols.size() != container.runs.size()){
+        cerr << "read_counts_container(): Symbols and runs differ in number in " << file_name << endl;
+        return false;
+    }
+    return true;
+}
+
+void decode_counts(const counts_container_t &container, vector<uint32_t> &counts){
+    counts.clear();
+    if(container.symbols.empty())
+        counts = container.counts;
+    else {
+        if(container.symbols.size() != container.runs.size()){
+            cerr << "decode_counts(): Symbols and runs differ in number" << endl;
+            exit(EXIT_FAILURE);
+        }
+        for(size_t i = 0; i < container.symbols.size(); i++)
+            counts.insert(counts.end(), container.runs[i], container.symbols[i]);
+    }
+
+    if(container.encoding == (uint32_t) encoding_t::BWT && !container.bwt_primary_indices.empty()){
+        vector<uint32_t> text;
+        bwt_inverse_blocks(counts, container.bwt_block_size, container.bwt_primary_indices, text);
+        counts.swap(text);
+    }
+}
@@ -0,0 +1,92 @@
+//
+// Binary .counts container: the streams produced by the Encoder, each with its own codec
+//MOD
+//
+
+#ifndef USTAR_COUNTSFILE_H
+#define USTAR_COUNTSFILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * How the values of a stream are stored
+ */
+enum class stream_codec_t : uint8_t{
+    RAW = 0,            // 4 bytes per value
+    RANS = 1,           // rans_encode()
+    VARINT = 2,         // varint_encode()
+    STREAM_VBYTE = 3,   // stream_vbyte_encode()
+    FOR = 4             // for_encode()
+};
+
+/**
+ * @param name raw, rans, varint, stream-vbyte or for
+ * @param codec the codec is returned here
+ * @return false if the name is unknown
+ */
+bool parse_stream_codec(const string &name, stream_codec_t &codec);
+
+/**
+ * Code a stream, in memory
+ * @param values the stream
+ * @param codec how
+ * @param payload the coded stream is appended here
+ */
+void encode_stream(const vector<uint32_t> &values, stream_codec_t codec, string &payload);
+
+/**
+ * Decode a stream coded by encode_stream()
+ * @param payload the coded stream
+ * @param size its size
+ * @param codec how it was coded
+ * @param n_values how many values it holds
+ * @param values the values are returned here
+ * @return false if the payload is corrupted or can't hold n_values, which is checked before allocating (a rANS stream
+ * of a single value below 64 holds any number of them)
+ */
+bool decode_stream(const char *payload, size_t size, stream_codec_t codec, size_t n_values, vector<uint32_t> &values);
+
+/**
+ * Content of a .counts file.
+ * RLE encodings fill symbols and runs, the others counts.
+ */
+struct counts_container_t{
+    uint32_t encoding = 0;                  // the encoding_t of the Encoder
+    float quantization_bound = 0;           // 0 for exact counts, else the max relative error of lossy counts
+    uint64_t bwt_block_size = 0;            // BWT only, 0 means one block
+    vector<uint64_t> bwt_primary_indices;   // BWT only, one per block
+    vector<uint32_t> symbols;
+    vector<uint32_t> runs;
+    vector<uint32_t> counts;
+};
+
+/**
+ * Write a binary .counts file.
+ * Layout: "USTC", version, encoding, quantization bound, BWT block size and primary indices, then each non empty stream
+ * as (stream ID, codec, number of values, payload size, payload). Numbers are little endian.
+ * @param file_name the output file
+ * @param container what to write
+ * @param codec the codec of every stream
+ */
+void write_counts_container(const string &file_name, const counts_container_t &container, stream_codec_t codec=stream_codec_t::RANS);
+
+/**
+ * Read a file written by write_counts_container()
+ * @param file_name the input file
+ * @param container the content is returned here
+ * @return false if the file can't be read or is corrupted (the reason is printed)
+ */
+bool read_counts_container(const string &file_name, counts_container_t &container);
+
+/**
+ * Rebuild the counts stream (the counts of every k-mer, in output order): expand runs and invert the BWT
+ * @param container a container
+ * @param counts the counts stream is returned here
+ */
+void decode_counts(const counts_container_t &container, vector<uint32_t> &counts);
+
+#endif //USTAR_COUNTSFILE_H
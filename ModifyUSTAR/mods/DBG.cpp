@@ -6,7 +6,24 @@
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <climits>
+#include <tuple>
+#include <iterator>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <tmmintrin.h>
+#define USTAR_HAVE_SSSE3_KERNEL
+#endif
 #include "DBG.h"
+#include "MappedFile.h"
+#include "FastWriter.h"
 #include "commons.h"
 
 size_t DBG::estimate_n_nodes(){
@@ -19,220 +36,299 @@ size_t DBG::estimate_n_nodes(){
     return file_size / MINIMUM_ENTRY_SIZE;
 }
 
-void DBG::parse_bcalm_file() {
-    ifstream bcalm_file;
-    bcalm_file.open(bcalm_file_name);
+uint32_t DBG::median_abundance(const vector<uint32_t> &abundances, uint32_t min_abundance, uint32_t max_abundance) {
+    // reused by every call, no allocation once they're big enough
+    static thread_local vector<uint32_t> scratch;
+    const size_t COUNTING_RANGE = 1024;
 
-    if(!bcalm_file.good()){
-        cerr << "parse_bcalm_file(): Can't access file " << bcalm_file_name << endl;
+    size_t n = abundances.size();
+    if(n == 0)
+        return 0;
+    if(min_abundance == max_abundance)
+        return min_abundance;
+    size_t rank = n / 2;
+
+    // small range (the usual case): count occurrences, then walk up to the middle rank
+    size_t range = (size_t) max_abundance - min_abundance + 1;
+    if(range <= COUNTING_RANGE && range <= n){
+        scratch.assign(range, 0);
+        for(uint32_t ab : abundances)
+            scratch[ab - min_abundance]++;
+        size_t seen = 0;
+        for(size_t v = 0; v < range; v++){
+            seen += scratch[v];
+            if(seen > rank)
+                return min_abundance + (uint32_t) v;
+        }
+    }
+
+    // selection on a copy
+    scratch.assign(abundances.begin(), abundances.end());
+    nth_element(scratch.begin(), scratch.begin() + (long) rank, scratch.end());
+    return scratch[rank];
+}
+
+bool DBG::parse_bcalm_record(istream &bcalm_file, uint32_t kmer_size, size_t expected_serial, string &line, node_t &node, uint64_t *file_offset) {
+    // escape comments
+    do{
+        if(!getline(bcalm_file, line))
+            return false;
+        if(file_offset != nullptr)
+            *file_offset += line.size() + 1;
+    }while(line[0] == '#');
+
+    size_t serial; // BCALM2 serial
+    char dyn_line[MAX_LINE_LEN]; // line after id and length
+
+    // reuse the node
+    node.abundances.clear();
+    node.arcs.clear();
+
+    // check if line fits in dyn_line
+    if(line.size() > MAX_LINE_LEN){
+        cerr << "parse_bcalm_file(): Lines must be smaller than " << MAX_LINE_LEN << " characters!" << endl;
         exit(EXIT_FAILURE);
     }
 
-    // improve vector push_back() time
-    nodes.reserve(estimate_n_nodes());
-    size_t nodes_cap = nodes.capacity();
-    if(debug)
-        cout << "estimated number of unitigs: " << estimate_n_nodes() << endl;
+    // ------ parse line ------
+    // Two supported formats:
+    // 1) Standard BCALM2 format: >25 LN:i:32 ab:Z:14 12   L:-:23:+ L:-:104831:+  L:+:22:-
+    //    - Simple numeric ID (e.g., "25")
+    //    - Contains "LN:i:" for unitig length
+    //    - Contains "ab:Z:" followed by space-separated integer abundances for each k-mer
+    //
+    // ########Cutterfish2 from the Logan project########
+    // 2) Alternative format:     >SRR11905265_0 ka:f:1.0    L:-:27885434:- 
+    //    - Named ID with underscore and number (e.g., "SRR11905265_0")
+    //    - No "LN:i:" field (length computed from sequence)
+    //    - Contains "ka:f:" followed by a single float value (average k-mer abundance)
+    //    - Individual k-mer abundances are not provided, so we replicate the average
 
-    // start parsing two line at a time
-    string line;
-    while(getline(bcalm_file, line)){
-        // escape comments
-        if(line[0] == '#')
-            continue;
+    // Check consistency: must have a def-line starting with '>'
+    if(line[0] != '>'){
+        cerr << "parse_bcalm_file(): Bad formatted input file: no def-line found!" << endl;
+        exit(EXIT_FAILURE);
+    }
 
-        size_t serial; // BCALM2 serial
-        char dyn_line[MAX_LINE_LEN]; // line after id and length
+    // AUTO-DETECT format type by searching for distinctive tags
+    // Standard format has both "LN:i:" (length) and "ab:Z:" (abundance array)
+    bool is_standard_format = (line.find("LN:i:") != string::npos && line.find("ab:Z:") != string::npos);
+    // Alternative format has "ka:f:" (k-mer average as float)
+    bool is_alternative_format = (line.find("ka:f:") != string::npos);
 
-        // make a new node
-        node_t node;
+    // Validate that exactly one format is detected
+    if(!is_standard_format && !is_alternative_format){
+        cerr << "parse_bcalm_file(): Unknown file format! Expected either 'LN:i:' and 'ab:Z:' or 'ka:f:'" << endl;
+        exit(EXIT_FAILURE);
+    }
 
-        // check if line fits in dyn_line
-        if(line.size() > MAX_LINE_LEN){
-            cerr << "parse_bcalm_file(): Lines must be smaller than " << MAX_LINE_LEN << " characters!" << endl;
-            exit(EXIT_FAILURE);
+    if(is_standard_format){
+        // STANDARD BCALM2 FORMAT PARSING
+        // Example: >25 LN:i:32 ab:Z:14 12 L:-:23:+
+        // Parse using scanf format: (skip '>') (read serial) (skip "LN:i:") (read length) (read rest)
+        // format string breakdown:
+        //   %*c    - skip '>' character
+        //   %zd    - read serial number (size_t)
+        //   %*5c   - skip 5 characters " LN:i"
+        //   %d     - read unitig length (int)
+        //   %[^\n]s - read rest of line until newline
+        sscanf(line.c_str(), "%*c %zd %*5c %d %[^\n]s", &serial, &node.length, dyn_line);
+    } else {// #### Cutterfish2 format ####
+        // ALTERNATIVE FORMAT PARSING
+        // Two supported patterns:
+        // 1) Named: >SRR11905265_0 ka:f:1.0 L:-:27885434:-
+        // 2) Simple: >0 ka:f:1.0 L:-:27885434:-
+        
+        // Find the underscore that separates prefix from serial number
+        size_t underscore_pos = line.find('_');
+        size_t space_pos = line.find(' ', 1); // Find first space after '>'
+        
+        if(underscore_pos != string::npos && underscore_pos < space_pos){
+            // Pattern: NAME_NUMBER (e.g., >SRR11905265_0)
+            // Extract the serial number: everything between '_' and first space
+            string serial_str = line.substr(underscore_pos + 1, space_pos - underscore_pos - 1);
+            serial = stoull(serial_str);  // Convert string to unsigned long long
+        } else {
+            // Pattern: NUMBER only (e.g., >0)
+            // Extract the serial number: everything between '>' and first space
+            string serial_str = line.substr(1, space_pos - 1);
+            serial = stoull(serial_str);  // Convert string to unsigned long long
         }
+        
+        // Copy the rest of the line (after first space) to dyn_line for further parsing
+        // This will contain: "ka:f:1.0 L:-:27885434:-"
+        strcpy(dyn_line, line.substr(space_pos + 1).c_str());
+        
+        // Length is not provided in header, will be computed from sequence later
+        node.length = 0;
+    }
 
-        // ------ parse line ------
-        // Two supported formats:
-        // 1) Standard BCALM2 format: >25 LN:i:32 ab:Z:14 12   L:-:23:+ L:-:104831:+  L:+:22:-
-        //    - Simple numeric ID (e.g., "25")
-        //    - Contains "LN:i:" for unitig length
-        //    - Contains "ab:Z:" followed by space-separated integer abundances for each k-mer
-        //
-        // ########Cutterfish2 from the Logan project########
-        // 2) Alternative format:     >SRR11905265_0 ka:f:1.0    L:-:27885434:- 
-        //    - Named ID with underscore and number (e.g., "SRR11905265_0")
-        //    - No "LN:i:" field (length computed from sequence)
-        //    - Contains "ka:f:" followed by a single float value (average k-mer abundance)
-        //    - Individual k-mer abundances are not provided, so we replicate the average
-
-        // Check consistency: must have a def-line starting with '>'
-        if(line[0] != '>'){
-            cerr << "parse_bcalm_file(): Bad formatted input file: no def-line found!" << endl;
-            exit(EXIT_FAILURE);
+    // check consistency:
+    // must have progressive IDs
+    if(serial != expected_serial){
+        cerr << "parse_bcalm_file(): Bad formatted input file: lines must have progressive IDs!" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // ------ parse abundances ------
+    char *token;
+    if(is_standard_format){
+        // STANDARD FORMAT: Parse array of k-mer abundances
+        // dyn_line example: "ab:Z:14 12 17   L:-:23:+ L:-:104831:+  L:+:22:-"
+        // Each integer between "ab:Z:" and first "L:" represents abundance of one k-mer
+        
+        uint64_t sum_abundance = 0;
+        uint32_t min_abundance = UINT32_MAX, max_abundance = 0;
+        // Start tokenizing after "ab:Z:" (skip first 5 characters)
+        token = strtok(dyn_line + 5, " ");
+        do{
+            uint32_t abundance = atoi(token);  // Convert token to integer
+            sum_abundance += abundance;         // Accumulate for average calculation
+            min_abundance = min(min_abundance, abundance); // Range for the median
+            max_abundance = max(max_abundance, abundance);
+            node.abundances.push_back(abundance);  // Store individual k-mer abundance
+            token = strtok(nullptr, " ");       // Get next token
+        }while(token != nullptr && token[0] != 'L');  // Stop when we hit arc definitions (L:...)
+        
+        // Calculate average abundance from all k-mer abundances
+        node.average_abundance = (double) sum_abundance / (double) node.abundances.size();
+        // Calculate median abundance in linear time (counting or selection, no sorting)
+        node.median_abundance = median_abundance(node.abundances, min_abundance, max_abundance);
+    } else {
+        // ALTERNATIVE FORMAT: Parse single average k-mer abundance value
+        // dyn_line example: "ka:f:1.0    L:-:27885434:-"
+        // Only one float value representing the AVERAGE abundance across all k-mers
+        
+        double avg_abundance;
+        // Extract the float value after "ka:f:"
+        sscanf(dyn_line, "ka:f:%lf", &avg_abundance);
+        
+        // Store the average abundance as-is (it's already calculated in the file)
+        node.average_abundance = avg_abundance;
+        // Since we don't have individual k-mer values, use average for median too
+        node.median_abundance = (uint32_t) avg_abundance;
+        
+        // NOTE: Individual k-mer abundances will be filled AFTER reading the sequence
+        // (we need to know how many k-mers exist, which requires sequence length)
+        // For now, just prepare to parse arcs
+        
+        // Find where arc definitions start (L: tags)
+        token = strstr(dyn_line, "L:");
+        if(token != nullptr){
+            // Prepare for arc parsing: tokenize to position at first L: tag
+            token = strtok(dyn_line, " ");  // First token is "ka:f:X.X"
+            token = strtok(nullptr, " ");    // Move to first arc or next field
         }
+    }
 
-        // AUTO-DETECT format type by searching for distinctive tags
-        // Standard format has both "LN:i:" (length) and "ab:Z:" (abundance array)
-        bool is_standard_format = (line.find("LN:i:") != string::npos && line.find("ab:Z:") != string::npos);
-        // Alternative format has "ka:f:" (k-mer average as float)
-        bool is_alternative_format = (line.find("ka:f:") != string::npos);
+    // ------ parse arcs ------
+    // token = "L:-:23:+ L:-:104831:+  L:+:22:-"
+    while(token != nullptr){
+        arc_t arc{};
+        char s1, s2; // left and right signs
+        sscanf(token, "%*2c %c %*c %d %*c %c", &s1, &arc.successor, &s2); // L:-:23:+
+        arc.forward = (s1 == '+');
+        arc.to_forward = (s2 == '+');
+        node.arcs.push_back(arc);
+        // next arcs
+        token = strtok(nullptr, " ");
+    }
 
-        // Validate that exactly one format is detected
-        if(!is_standard_format && !is_alternative_format){
-            cerr << "parse_bcalm_file(): Unknown file format! Expected either 'LN:i:' and 'ab:Z:' or 'ka:f:'" << endl;
-            exit(EXIT_FAILURE);
-        }
+    // ------ parse sequence line ------
+    // TTGAAGGTAACGGATGTTCTAGTTTTTTCTCTTT}
+    if(!getline(bcalm_file, line)){
+        cerr << "parse_bcalm_file(): expected a sequence here!" << endl;
+        exit(EXIT_FAILURE);
+    }
 
-        if(is_standard_format){
-            // STANDARD BCALM2 FORMAT PARSING
-            // Example: >25 LN:i:32 ab:Z:14 12 L:-:23:+
-            // Parse using scanf format: (skip '>') (read serial) (skip "LN:i:") (read length) (read rest)
-            // format string breakdown:
-            //   %*c    - skip '>' character
-            //   %zd    - read serial number (size_t)
-            //   %*5c   - skip 5 characters " LN:i"
-            //   %d     - read unitig length (int)
-            //   %[^\n]s - read rest of line until newline
-            sscanf(line.c_str(), "%*c %zd %*5c %d %[^\n]s", &serial, &node.length, dyn_line);
-        } else {// #### Cutterfish2 format ####
-            // ALTERNATIVE FORMAT PARSING
-            // Two supported patterns:
-            // 1) Named: >SRR11905265_0 ka:f:1.0 L:-:27885434:-
-            // 2) Simple: >0 ka:f:1.0 L:-:27885434:-
-            
-            // Find the underscore that separates prefix from serial number
-            size_t underscore_pos = line.find('_');
-            size_t space_pos = line.find(' ', 1); // Find first space after '>'
-            
-            if(underscore_pos != string::npos && underscore_pos < space_pos){
-                // Pattern: NAME_NUMBER (e.g., >SRR11905265_0)
-                // Extract the serial number: everything between '_' and first space
-                string serial_str = line.substr(underscore_pos + 1, space_pos - underscore_pos - 1);
-                serial = stoull(serial_str);  // Convert string to unsigned long long
-            } else {
-                // Pattern: NUMBER only (e.g., >0)
-                // Extract the serial number: everything between '>' and first space
-                string serial_str = line.substr(1, space_pos - 1);
-                serial = stoull(serial_str);  // Convert string to unsigned long long
-            }
-            
-            // Copy the rest of the line (after first space) to dyn_line for further parsing
-            // This will contain: "ka:f:1.0 L:-:27885434:-"
-            strcpy(dyn_line, line.substr(space_pos + 1).c_str());
-            
-            // Length is not provided in header, will be computed from sequence later
-            node.length = 0;
-        }
+    if(file_offset != nullptr)
+        *file_offset += line.size() + 1;
 
-        // check consistency:
-        // must have progressive IDs
-        if(serial != nodes.size()){
-            cerr << "parse_bcalm_file(): Bad formatted input file: lines must have progressive IDs!" << endl;
-            exit(EXIT_FAILURE);
-        }
+    // ------ read sequence ------
+    // Get the unitig sequence from the second line (DNA/RNA nucleotides)
+    node.unitig = line;
 
-        // ------ parse abundances ------
-        char *token;
-        if(is_standard_format){
-            // STANDARD FORMAT: Parse array of k-mer abundances
-            // dyn_line example: "ab:Z:14 12 17   L:-:23:+ L:-:104831:+  L:+:22:-"
-            // Each integer between "ab:Z:" and first "L:" represents abundance of one k-mer
-            
-            uint32_t sum_abundance = 0;
-            // Start tokenizing after "ab:Z:" (skip first 5 characters)
-            token = strtok(dyn_line + 5, " ");
-            do{
-                uint32_t abundance = atoi(token);  // Convert token to integer
-                sum_abundance += abundance;         // Accumulate for average calculation
-                node.abundances.push_back(abundance);  // Store individual k-mer abundance
-                token = strtok(nullptr, " ");       // Get next token
-            }while(token != nullptr && token[0] != 'L');  // Stop when we hit arc definitions (L:...)
-            
-            // Calculate average abundance from all k-mer abundances
-            node.average_abundance = sum_abundance / (double) node.abundances.size();
-            // Calculate median abundance (requires sorting, done in median() function)
-            node.median_abundance = median(node.abundances);
-        } else {
-            // ALTERNATIVE FORMAT: Parse single average k-mer abundance value
-            // dyn_line example: "ka:f:1.0    L:-:27885434:-"
-            // Only one float value representing the AVERAGE abundance across all k-mers
-            
-            double avg_abundance;
-            // Extract the float value after "ka:f:"
-            sscanf(dyn_line, "ka:f:%lf", &avg_abundance);
-            
-            // Store the average abundance as-is (it's already calculated in the file)
-            node.average_abundance = avg_abundance;
-            // Since we don't have individual k-mer values, use average for median too
-            node.median_abundance = (uint32_t) avg_abundance;
-            
-            // NOTE: Individual k-mer abundances will be filled AFTER reading the sequence
-            // (we need to know how many k-mers exist, which requires sequence length)
-            // For now, just prepare to parse arcs
-            
-            // Find where arc definitions start (L: tags)
-            token = strstr(dyn_line, "L:");
-            if(token != nullptr){
-                // Prepare for arc parsing: tokenize to position at first L: tag
-                token = strtok(dyn_line, " ");  // First token is "ka:f:X.X"
-                token = strtok(nullptr, " ");    // Move to first arc or next field
-            }
+    // ALTERNATIVE FORMAT ONLY: Finalize length and populate abundances array
+    if(!is_standard_format){
+        // Now that we have the sequence, we can compute the unitig length
+        node.length = node.unitig.size();
+        
+        // Calculate how many k-mers are in this unitig
+        // Formula: for a sequence of length L and k-mer size K, there are (L - K + 1) k-mers
+        // Example: sequence "ACGTACGT" with k=3 has 6 k-mers: ACG, CGT, GTA, TAC, ACG, CGT
+        size_t n_kmers = node.unitig.size() - kmer_size + 1;
+        
+        // Since we only have one average value, replicate it for each k-mer position
+        // This is necessary because the rest of the code expects an abundance value per k-mer
+        // We use the integer cast of average_abundance to maintain consistency
+        for(size_t i = 0; i < n_kmers; i++){
+            node.abundances.push_back((uint32_t) node.average_abundance);
         }
+    }
 
-        // ------ parse arcs ------
-        // token = "L:-:23:+ L:-:104831:+  L:+:22:-"
-        while(token != nullptr){
-            arc_t arc{};
-            char s1, s2; // left and right signs
-            sscanf(token, "%*2c %c %*c %d %*c %c", &s1, &arc.successor, &s2); // L:-:23:+
-            arc.forward = (s1 == '+');
-            arc.to_forward = (s2 == '+');
-            node.arcs.push_back(arc);
-            // next arcs
-            token = strtok(nullptr, " ");
-        }
+    // CONSISTENCY CHECK: Verify that we have exactly one abundance value per k-mer
+    // This should always be true if parsing was correct
+    // Formula: number_of_kmers = sequence_length - kmer_size + 1
+    if((node.unitig.size() - kmer_size + 1) != node.abundances.size()){
+        cerr << "parse_bcalm_file(): Bad formatted input file: wrong number of abundances!" << endl;
+        cerr << "parse_bcalm_file(): Sequence length: " << node.unitig.size() << endl;
+        cerr << "parse_bcalm_file(): Expected k-mers: " << (node.unitig.size() - kmer_size + 1) << endl;
+        cerr << "parse_bcalm_file(): Actual abundances: " << node.abundances.size() << endl;
+        cerr << "parse_bcalm_file(): Also make sure that kmer_size=" << kmer_size << endl;
+        exit(EXIT_FAILURE);
+    }
 
-        // ------ parse sequence line ------
-        // TTGAAGGTAACGGATGTTCTAGTTTTTTCTCTTT}
-        if(!getline(bcalm_file, line)){
-            cerr << "parse_bcalm_file(): expected a sequence here!" << endl;
-            exit(EXIT_FAILURE);
-        }
+    return true;
+}
+
+void DBG::parse_bcalm_file() {
+    ifstream bcalm_file;
+    bcalm_file.open(bcalm_file_name);
 
-        // ------ read sequence ------
-        // Get the unitig sequence from the second line (DNA/RNA nucleotides)
-        node.unitig = line;
-
-        // ALTERNATIVE FORMAT ONLY: Finalize length and populate abundances array
-        if(!is_standard_format){
-            // Now that we have the sequence, we can compute the unitig length
-            node.length = node.unitig.size();
-            
-            // Calculate how many k-mers are in this unitig
-            // Formula: for a sequence of length L and k-mer size K, there are (L - K + 1) k-mers
-            // Example: sequence "ACGTACGT" with k=3 has 6 k-mers: ACG, CGT, GTA, TAC, ACG, CGT
-            size_t n_kmers = node.unitig.size() - kmer_size + 1;
-            
-            // Since we only have one average value, replicate it for each k-mer position
-            // This is necessary because the rest of the code expects an abundance value per k-mer
-            // We use the integer cast of average_abundance to maintain consistency
-            for(size_t i = 0; i < n_kmers; i++){
-                node.abundances.push_back((uint32_t) node.average_abundance);
+    if(!bcalm_file.good()){
+        cerr << "parse_bcalm_file(): Can't access file " << bcalm_file_name << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // improve vector push_back() time
+    nodes.reserve(estimate_n_nodes());
+    size_t nodes_cap = nodes.capacity();
+    if(debug)
+        cout << "estimated number of unitigs: " << estimate_n_nodes() << endl;
+
+    // new ID of each record, only when filtering
+    const node_idx_t DROPPED = UINT32_MAX;
+    vector<node_idx_t> new_ids;
+
+    // start parsing two line at a time
+    string line;
+    node_t node;
+    uint64_t file_offset = 0;
+    size_t n_records = 0;
+    ComponentTracker components;
+    while(parse_bcalm_record(bcalm_file, kmer_size, n_records++, line, node, &file_offset)){
+        if(options.filtering()){
+            if(!options.keep(node)){
+                new_ids.push_back(DROPPED);
+                n_filtered++;
+                continue;
             }
+            new_ids.push_back(nodes.size());
+            original_ids.push_back(n_records - 1);
+        } else {
+            // statistics are collected here, no need to loop on nodes again
+            stats.add_node(node);
+            components.add_node(nodes.size(), node);
         }
 
-        // CONSISTENCY CHECK: Verify that we have exactly one abundance value per k-mer
-        // This should always be true if parsing was correct
-        // Formula: number_of_kmers = sequence_length - kmer_size + 1
-        if((node.unitig.size() - kmer_size + 1) != node.abundances.size()){
-            cerr << "parse_bcalm_file(): Bad formatted input file: wrong number of abundances!" << endl;
-            cerr << "parse_bcalm_file(): Sequence length: " << node.unitig.size() << endl;
-            cerr << "parse_bcalm_file(): Expected k-mers: " << (node.unitig.size() - kmer_size + 1) << endl;
-            cerr << "parse_bcalm_file(): Actual abundances: " << node.abundances.size() << endl;
-            cerr << "parse_bcalm_file(): Also make sure that kmer_size=" << kmer_size << endl;
-            exit(EXIT_FAILURE);
+        if(options.lazy_sequences){
+            // the sequence line ends just before file_offset
+            if(node.length != node.unitig.size()){
+                cerr << "parse_bcalm_file(): Bad formatted input file: LN:i: doesn't match the sequence length!" << endl;
+                exit(EXIT_FAILURE);
+            }
+            unitig_offsets.push_back(file_offset - node.unitig.size() - 1);
+            node.unitig.clear();
         }
 
         // save the node
@@ -246,30 +342,99 @@ void DBG::parse_bcalm_file() {
         }
     }
     nodes.shrink_to_fit();
+    unitig_offsets.shrink_to_fit();
     bcalm_file.close();
+
+    // renumber arc successors, dropping arcs to filtered unitigs; statistics are collected on the final arcs
+    if(options.filtering()){
+        for(size_t n = 0; n < nodes.size(); n++){
+            vector<arc_t> &arcs = nodes[n].arcs;
+            size_t kept = 0;
+            for(const arc_t &arc : arcs){
+                if(arc.successor >= new_ids.size() || new_ids[arc.successor] == DROPPED)
+                    continue;
+                arcs[kept] = arc;
+                arcs[kept++].successor = new_ids[arc.successor];
+            }
+            arcs.resize(kept);
+            arcs.shrink_to_fit();
+
+            stats.add_node(nodes[n]);
+            components.add_node(n, nodes[n]);
+        }
+        vector<node_idx_t>().swap(new_ids);
+
+        if(debug)
+            cout << "parse_bcalm_file(): " << n_filtered << " unitigs filtered out\n";
+    }
+    components.finish(nodes.size(), stats.component_size);
+
+    // sequences will be read from here
+    if(options.lazy_sequences){
+        unitigs_file = make_unique<MappedFile>(bcalm_file_name, false);
+        if(!unitigs_file->good() && !nodes.empty()){
+            cerr << "parse_bcalm_file(): Can't map file " << bcalm_file_name << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // before renumbering, so that the arcs reported are those of the input
+    if(options.check_arcs){
+        size_t n_dangling = verify_arc_symmetry(options.arc_repair);
+        if(n_dangling > 0)
+            cerr << "parse_bcalm_file(): " << n_dangling << " arcs have no reverse"
+                 << (options.arc_repair == arc_repair_t::ADD_MISSING ? ", their reverses were added"
+                   : options.arc_repair == arc_repair_t::DROP_DANGLING ? ", they were dropped" : "") << endl;
+    }
+
+    if(options.node_order != node_order_t::ORIGINAL)
+        reorder_nodes(options.node_order);
+}
+
+void DBG::convert(const string &in_file_name, const string &out_file_name, uint32_t kmer_size, unitig_format_t format) {
+    ifstream in_file;
+    in_file.open(in_file_name);
+
+    if(!in_file.good()){
+        cerr << "convert(): Can't access file " << in_file_name << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    FastWriter out_file(out_file_name);
+    serialize_header(format, out_file.get_buffer());
+
+    // only one record at a time is in memory
+    string line;
+    node_t node;
+    size_t id = 0;
+    while(parse_bcalm_record(in_file, kmer_size, id, line, node)){
+        serialize_record(node, node.unitig, id++, format, kmer_size, out_file.get_buffer());
+        out_file.commit();
+    }
+
+    out_file.close();
+    in_file.close();
 }
 
-DBG::DBG(const string &bcalm_file_name, uint32_t kmer_size, bool debug){
+bool parse_options_t::keep(const node_t &node) const {
+    return node.average_abundance >= min_average_abundance
+            && node.median_abundance >= min_median_abundance
+            && node.length >= min_length;
+}
+
+DBG::DBG(const string &bcalm_file_name, uint32_t kmer_size, bool debug) : DBG(bcalm_file_name, kmer_size, default_parse_options, debug){}
+
+DBG::DBG(const string &bcalm_file_name, uint32_t kmer_size, const parse_options_t &options, bool debug){
     this->bcalm_file_name = bcalm_file_name;
     this->kmer_size = kmer_size;
+    this->options = options;
     this->debug = debug;
 
-    // build the graph
+    // build the graph and its statistics
     parse_bcalm_file();
 
-    // compute graph parameters
-    size_t sum_unitig_length = 0;
-    double sum_abundances = 0;
-    for(const auto &node : nodes) {
-        n_arcs += node.arcs.size();
-        n_kmers += node.abundances.size();
-        sum_unitig_length += node.length;
-        sum_abundances += node.average_abundance * (double) node.abundances.size();
-
-        if(node.arcs.empty()) n_iso++;
-    }
-    avg_unitig_len = (double) sum_unitig_length / (double) nodes.size();
-    avg_abundances = sum_abundances / (double) n_kmers;
+    if(!options.stats_json_file_name.empty() && !stats.save_json(options.stats_json_file_name))
+        cerr << "DBG(): Can't write the statistics to " << options.stats_json_file_name << endl;
 }
 
 DBG::~DBG() = default;
@@ -277,95 +442,734 @@ DBG::~DBG() = default;
 void DBG::print_stat() {
     cout << "\n";
     cout << "DBG stats:\n";
-    cout << "   number of kmers:            " << n_kmers << "\n";
+    cout << "   number of kmers:            " << stats.n_kmers << "\n";
     cout << "   number of nodes:            " << nodes.size() << "\n";
-    cout << "   number of isolated nodes:   " << n_iso << " (" << double (n_iso) / double (nodes.size()) * 100 << "%)\n";
-    cout << "   number of arcs:             " << n_arcs << "\n";
-    cout << "   graph density:              " << double (n_arcs) / double (8 * nodes.size()) * 100 << "%\n";
-    cout << "   average unitig length:      " << avg_unitig_len << "\n";
-    cout << "   average abundances:         " << avg_abundances << "\n";
+    if(options.filtering())
+        cout << "   filtered nodes:             " << n_filtered << "\n";
+    cout << "   number of isolated nodes:   " << stats.n_iso << " (" << double (stats.n_iso) / double (nodes.size()) * 100 << "%)\n";
+    cout << "   number of arcs:             " << stats.n_arcs << "\n";
+    cout << "   graph density:              " << double (stats.n_arcs) / double (8 * nodes.size()) * 100 << "%\n";
+    cout << "   average unitig length:      " << stats.avg_unitig_len() << "\n";
+    cout << "   average abundances:         " << stats.avg_abundances() << "\n";
+    if(debug) {
+        cout << "   unitig length (median/max): " << stats.unitig_length.quantile(0.5) << " / " << stats.unitig_length.get_max() << "\n";
+        cout << "   abundance (median/max):     " << stats.kmer_abundance.quantile(0.5) << " / " << stats.kmer_abundance.get_max() << "\n";
+        cout << "   connected components:       " << stats.component_size.get_count() << " (largest: " << stats.component_size.get_max() << ")\n";
+    }
     cout << "\n";
 }
 
+const dbg_stats_t &DBG::get_stats() const {
+    return stats;
+}
+
 bool DBG::verify_overlaps() {
-    for(const auto &node : nodes){
-        for(const auto &arc : node.arcs)
-            if(!overlaps(node, arc))
-                return false;
+    vector<pair<node_idx_t, uint32_t>> violations;
+    size_t n_violations = verify_overlaps(violations);
+
+    if(n_violations > 0) {
+        cerr << "verify_overlaps(): " << n_violations << " arcs don't overlap" << endl;
+        if(debug)
+            for(const auto &v : violations) {
+                const arc_t &arc = nodes[v.first].arcs[v.second];
+                cerr << "   " << v.first << " L:" << (arc.forward ? "+" : "-") << ":" << arc.successor << ":" << (arc.to_forward ? "+" : "-") << "\n";
+            }
+    }
+    return n_violations == 0;
+}
+
+size_t DBG::verify_overlaps(vector<pair<node_idx_t, uint32_t>> &violations, unsigned n_threads) {
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    n_threads = (unsigned) min((size_t) n_threads, max((size_t) 1, nodes.size()));
+
+    // each thread checks a contiguous range of nodes and keeps its own violations
+    vector<vector<pair<node_idx_t, uint32_t>>> thread_violations(n_threads);
+    auto check_range = [this, &thread_violations](unsigned t, size_t begin, size_t end){
+        for(size_t n = begin; n < end; n++) {
+            const vector<arc_t> &arcs = nodes[n].arcs;
+            for(uint32_t a = 0; a < arcs.size(); a++)
+                if(arcs[a].successor >= nodes.size() || !overlaps(n, arcs[a]))
+                    thread_violations[t].emplace_back(n, a);
+        }
+    };
+
+    size_t range = (nodes.size() + n_threads - 1) / n_threads;
+    vector<thread> threads;
+    for(unsigned t = 1; t < n_threads; t++)
+        threads.emplace_back(check_range, t, min(t * range, nodes.size()), min((t + 1) * range, nodes.size()));
+    check_range(0, 0, min(range, nodes.size()));
+    for(auto &th : threads)
+        th.join();
+
+    // ranges are in node order
+    violations.clear();
+    for(const auto &tv : thread_violations)
+        violations.insert(violations.end(), tv.begin(), tv.end());
+    return violations.size();
+}
+
+/**
+ * An arc as a sortable edge
+ */
+struct edge_t{
+    node_idx_t from;
+    node_idx_t to;
+    bool forward;
+    bool to_forward;
+
+    bool operator<(const edge_t &other) const{
+        return tie(from, to, forward, to_forward) < tie(other.from, other.to, other.forward, other.to_forward);
+    }
+
+    bool operator==(const edge_t &other) const{
+        return from == other.from && to == other.to && forward == other.forward && to_forward == other.to_forward;
+    }
+
+    /**
+     * @return the same arc read on the other strand: u + --> v + becomes v - --> u -
+     */
+    edge_t reverse() const{
+        return {to, from, !to_forward, !forward};
+    }
+};
+
+/**
+ * Sort in parallel: chunks are sorted by different threads, then merged pairwise
+ */
+template<typename T>
+static void parallel_sort(vector<T> &v, unsigned n_threads){
+    size_t n_chunks = max((size_t) 1, min((size_t) n_threads, v.size() / 4096));
+    vector<size_t> bounds(n_chunks + 1);
+    for(size_t c = 0; c <= n_chunks; c++)
+        bounds[c] = v.size() / n_chunks * c;
+    bounds[n_chunks] = v.size();
+
+    vector<thread> threads;
+    for(size_t c = 0; c < n_chunks; c++)
+        threads.emplace_back([&v, &bounds, c](){ sort(v.begin() + (long) bounds[c], v.begin() + (long) bounds[c + 1]); });
+    for(auto &th : threads)
+        th.join();
+
+    // merge neighbouring runs until one is left
+    for(size_t width = 1; width < n_chunks; width *= 2){
+        threads.clear();
+        for(size_t c = 0; c + width < n_chunks; c += 2 * width){
+            size_t last = min(c + 2 * width, n_chunks);
+            threads.emplace_back([&v, &bounds, c, width, last](){
+                inplace_merge(v.begin() + (long) bounds[c], v.begin() + (long) bounds[c + width], v.begin() + (long) bounds[last]);
+            });
+        }
+        for(auto &th : threads)
+            th.join();
+    }
+}
+
+size_t DBG::verify_arc_symmetry(arc_repair_t repair, unsigned n_threads) {
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    n_threads = (unsigned) min((size_t) n_threads, max((size_t) 1, nodes.size()));
+
+    // every thread lists the arcs of a range of nodes and the reverse arcs they require
+    vector<size_t> first_arc(nodes.size() + 1, 0);
+    for(size_t n = 0; n < nodes.size(); n++)
+        first_arc[n + 1] = first_arc[n] + nodes[n].arcs.size();
+    vector<edge_t> arcs(first_arc.back()), reverses(first_arc.back());
+    atomic<size_t> n_out_of_range{0};
+
+    size_t range = (nodes.size() + n_threads - 1) / n_threads;
+    vector<thread> threads;
+    for(unsigned t = 0; t < n_threads; t++)
+        threads.emplace_back([&, t](){
+            for(size_t n = t * range; n < min((t + 1) * range, nodes.size()); n++){
+                for(size_t a = 0, i = first_arc[n]; a < nodes[n].arcs.size(); a++, i++){
+                    const arc_t &arc = nodes[n].arcs[a];
+                    arcs[i] = {(node_idx_t) n, arc.successor, arc.forward, arc.to_forward};
+                    reverses[i] = arcs[i].reverse();
+                    if(arc.successor >= nodes.size())
+                        n_out_of_range++;
+                }
+            }
+        });
+    for(auto &th : threads)
+        th.join();
+    vector<size_t>().swap(first_arc);
+
+    threads.clear();
+    threads.emplace_back([&](){
+        parallel_sort(arcs, max(1u, n_threads / 2));
+        arcs.erase(unique(arcs.begin(), arcs.end()), arcs.end());
+    });
+    parallel_sort(reverses, max(1u, n_threads - n_threads / 2));
+    reverses.erase(unique(reverses.begin(), reverses.end()), reverses.end());
+    threads[0].join();
+
+    // an arc is symmetric if it is the reverse of some arc:
+    // arcs \ reverses have no reverse, reverses \ arcs are the missing ones
+    vector<edge_t> dangling, missing;
+    set_difference(arcs.begin(), arcs.end(), reverses.begin(), reverses.end(), back_inserter(dangling));
+    set_difference(reverses.begin(), reverses.end(), arcs.begin(), arcs.end(), back_inserter(missing));
+    vector<edge_t>().swap(arcs);
+    vector<edge_t>().swap(reverses);
+
+    if(debug)
+        cout << "verify_arc_symmetry(): " << dangling.size() << " arcs without reverse (" << n_out_of_range << " to missing nodes)\n";
+
+    if(repair == arc_repair_t::ADD_MISSING){
+        // arcs to missing nodes have nowhere to put their reverse
+        size_t added = 0;
+        for(const edge_t &e : missing)
+            if(e.from < nodes.size()) {
+                nodes[e.from].arcs.push_back({e.to, e.forward, e.to_forward});
+                added++;
+            }
+        if(debug)
+            cout << "verify_arc_symmetry(): " << added << " reverse arcs added\n";
+    }
+    if(repair == arc_repair_t::DROP_DANGLING){
+        // dangling is sorted by node: remove each node's arcs in one pass
+        for(size_t i = 0; i < dangling.size();){
+            node_idx_t from = dangling[i].from;
+            size_t end = i;
+            while(end < dangling.size() && dangling[end].from == from)
+                end++;
+            vector<arc_t> &node_arcs = nodes[from].arcs;
+            node_arcs.erase(remove_if(node_arcs.begin(), node_arcs.end(), [&](const arc_t &arc){
+                edge_t e{from, arc.successor, arc.forward, arc.to_forward};
+                return binary_search(dangling.begin() + (long) i, dangling.begin() + (long) end, e);
+            }), node_arcs.end());
+            i = end;
+        }
+        if(debug)
+            cout << "verify_arc_symmetry(): " << dangling.size() << " dangling arcs dropped\n";
+    }
+    if(repair != arc_repair_t::NONE && !dangling.empty())
+        recount_arc_stats();
+
+    return dangling.size();
+}
+
+void DBG::recount_arc_stats() {
+    stats.n_arcs = 0;
+    stats.n_iso = 0;
+    stats.degree = Histogram();
+    stats.component_size = Histogram();
+
+    ComponentTracker components;
+    for(size_t n = 0; n < nodes.size(); n++){
+        stats.n_arcs += nodes[n].arcs.size();
+        if(nodes[n].arcs.empty()) stats.n_iso++;
+        stats.degree.add(nodes[n].arcs.size());
+        components.add_node(n, nodes[n]);
+    }
+    components.finish(nodes.size(), stats.component_size);
+}
+
+/**
+ * Breadth-first visit over the arcs. Only nodes with from <= mark < to are visited, and they are marked to.
+ * @param nodes the nodes
+ * @param start the first node (it must be visitable)
+ * @param mark visit state of every node
+ * @param by_degree visit the successors of a node from the least connected (Cuthill-McKee)
+ * @param order visited nodes are appended here
+ */
+static void visit_breadth_first(const vector<node_t> &nodes, node_idx_t start, vector<uint8_t> &mark, uint8_t from, uint8_t to,
+                                bool by_degree, vector<node_idx_t> &order){
+    size_t head = order.size();
+    mark[start] = to;
+    order.push_back(start);
+    while(head < order.size()){
+        node_idx_t node = order[head++];
+        size_t first_successor = order.size();
+        for(const arc_t &arc : nodes[node].arcs)
+            if(arc.successor < nodes.size() && mark[arc.successor] >= from && mark[arc.successor] < to){
+                mark[arc.successor] = to;
+                order.push_back(arc.successor);
+            }
+        if(by_degree)
+            stable_sort(order.begin() + (long) first_successor, order.end(), [&nodes](node_idx_t a, node_idx_t b){
+                return nodes[a].arcs.size() < nodes[b].arcs.size();
+            });
+    }
+}
+
+/**
+ * Move v[order[i]] to v[i] for every i, following the cycles of the permutation
+ */
+template<typename T>
+static void permute(vector<T> &v, const vector<node_idx_t> &order){
+    vector<bool> done(v.size(), false);
+    for(size_t i = 0; i < v.size(); i++){
+        if(done[i])
+            continue;
+        T moved = std::move(v[i]);
+        size_t j = i;
+        while(order[j] != i){
+            v[j] = std::move(v[order[j]]);
+            done[j] = true;
+            j = order[j];
+        }
+        v[j] = std::move(moved);
+        done[j] = true;
+    }
+}
+
+void DBG::reorder_nodes(node_order_t order) {
+    if(order == node_order_t::ORIGINAL)
+        return;
+
+    // new_order[i] is the node that will get ID i
+    vector<node_idx_t> new_order;
+    new_order.reserve(nodes.size());
+    vector<uint8_t> mark(nodes.size(), 0);
+    vector<node_idx_t> component;
+
+    for(size_t n = 0; n < nodes.size(); n++){
+        if(mark[n] != 0)
+            continue;
+
+        if(order == node_order_t::BFS){
+            visit_breadth_first(nodes, n, mark, 0, 1, false, new_order);
+            continue;
+        }
+
+        component.clear();
+        visit_breadth_first(nodes, n, mark, 0, 1, false, component);
+
+        if(order == node_order_t::COMPONENTS){
+            sort(component.begin(), component.end());
+            new_order.insert(new_order.end(), component.begin(), component.end());
+            continue;
+        }
+
+        // RCM: start from a pseudo-peripheral node, i.e. the farthest one from a least connected node
+        node_idx_t start = *min_element(component.begin(), component.end(), [this](node_idx_t a, node_idx_t b){
+            return nodes[a].arcs.size() < nodes[b].arcs.size();
+        });
+        vector<node_idx_t> levels;
+        visit_breadth_first(nodes, start, mark, 1, 2, false, levels);
+        start = levels.back();
+
+        size_t first = new_order.size();
+        visit_breadth_first(nodes, start, mark, 1, 3, true, new_order);
+        // nodes not reachable from start (asymmetric arcs)
+        for(node_idx_t c : component)
+            if(mark[c] != 3)
+                visit_breadth_first(nodes, c, mark, 1, 3, true, new_order);
+        reverse(new_order.begin() + (long) first, new_order.end());
+    }
+    vector<uint8_t>().swap(mark);
+    vector<node_idx_t>().swap(component);
+
+    vector<node_idx_t> new_ids(nodes.size());
+    for(size_t i = 0; i < new_order.size(); i++)
+        new_ids[new_order[i]] = i;
+
+    permute(nodes, new_order);
+    for(node_t &node : nodes)
+        for(arc_t &arc : node.arcs)
+            if(arc.successor < nodes.size())
+                arc.successor = new_ids[arc.successor];
+    if(!unitig_offsets.empty())
+        permute(unitig_offsets, new_order);
+
+    if(original_ids.empty())
+        original_ids.swap(new_order);
+    else
+        permute(original_ids, new_order);
+
+    if(debug)
+        cout << "reorder_nodes(): " << nodes.size() << " nodes renumbered\n";
+}
+
+node_idx_t DBG::get_original_id(node_idx_t node) const {
+    return original_ids.empty() ? node : original_ids.at(node);
+}
+
+void DBG::write_original_ids(const string &file_name) const {
+    FastWriter out_file(file_name);
+    for(size_t n = 0; n < nodes.size(); n++){
+        string &buffer = out_file.get_buffer();
+        append_number(buffer, n);
+        buffer.push_back(' ');
+        append_number(buffer, get_original_id(n));
+        buffer.push_back('\n');
+        out_file.commit();
+    }
+}
+
+bool DBG::overlaps(node_idx_t node, const arc_t &arcs){
+    const size_t overlap = kmer_size - 1;
+    string_view from = get_unitig(node);
+    string_view to = get_unitig(arcs.successor);
+    if(from.length() < overlap || to.length() < overlap)
+        return false;
+
+    // + --> + : last kmer_size - 1 characters of from == first kmer_size - 1 characters of to
+    // - --> - : the same comparison reverse-complemented on both sides
+    const char *from_end = from.data() + from.length() - overlap;
+    const char *to_end = to.data() + to.length() - overlap;
+    if(arcs.forward && arcs.to_forward)
+        return memcmp(from_end, to.data(), overlap) == 0;
+    if(!arcs.forward && !arcs.to_forward)
+        return memcmp(from.data(), to_end, overlap) == 0;
+
+    // + --> - : last characters of from == last characters of to reverse-complemented
+    // - --> + : first characters of from == first characters of to reverse-complemented
+    const char *a = arcs.forward ? from_end : from.data();
+    const char *b = arcs.forward ? to_end : to.data();
+
+    // reverse-complement b one chunk at a time and compare words
+    const size_t CHUNK_SIZE = 64;
+    char rc_chunk[CHUNK_SIZE];
+    for(size_t i = 0; i < overlap; i += CHUNK_SIZE){
+        size_t chunk = min(CHUNK_SIZE, overlap - i);
+        reverse_complement(b + overlap - i - chunk, chunk, rc_chunk);
+        if(memcmp(a + i, rc_chunk, chunk) != 0)
+            return false;
     }
     return true;
 }
 
-bool DBG::overlaps(const node_t &node, const arc_t &arcs){
-    string u1, u2;
-    if (arcs.forward) // + --> +/-
-        // last kmer_size - 1 characters
-        u1 = node.unitig.substr(node.unitig.length() - kmer_size + 1);
-    else // - --> +/-
-        // first kmer_size - 1 characters reverse-complemented
-        u1 = reverse_complement(node.unitig.substr(0, kmer_size - 1));
+ambiguity_policy_t DBG::ambiguity_policy = ambiguity_policy_t::STRICT;
+
+void DBG::set_ambiguity_policy(ambiguity_policy_t policy) {
+    ambiguity_policy = policy;
+}
 
-    if(arcs.to_forward) // +/- --> +
-        // first kmer_size - 1 characters
-        u2 = nodes[arcs.successor].unitig.substr(0, kmer_size - 1);
-    else  // +/- --> -
-        // last kmer_size - 1 characters reverse-complemented
-        u2 = reverse_complement(nodes[arcs.successor].unitig.substr(nodes[arcs.successor].unitig.length() - kmer_size + 1));
+parse_options_t DBG::default_parse_options;
 
-    return u1 == u2;
+void DBG::set_default_parse_options(const parse_options_t &options) {
+    default_parse_options = options;
 }
 
-string DBG::reverse_complement(const string &s) {
-    string rc(s);
-
-    for(size_t i = 0; i < s.length(); i++) {
-        char c;
-        switch (s[i]) {
-            case 'A':
-            case 'a':
-                c = 'T';
-                break;
-            case 'C':
-            case 'c':
-                c = 'G';
-                break;
-            case 'T':
-            case 't':
-                c = 'A';
-                break;
-            case 'G':
-            case 'g':
-                c = 'C';
-                break;
-            default:
-                cerr << "reverse_complement(): Unknown nucleotide!" << endl;
-                exit(EXIT_FAILURE);
+/**
+ * Build the complement table of a policy
+ * @param policy how non-ACGT bytes are handled
+ * @return 256 complements, 0 where the byte must be rejected
+ */
+static array<char, 256> make_complement_table(ambiguity_policy_t policy){
+    array<char, 256> table{};
+
+    if(policy == ambiguity_policy_t::TO_N)
+        table.fill('N');
+
+    if(policy == ambiguity_policy_t::IUPAC){
+        const char *from = "NRYKMSWBVDH";
+        const char *to   = "NYRMKSWVBHD";
+        for(size_t i = 0; from[i] != '\0'; i++) {
+            table[(unsigned char) from[i]] = to[i];
+            table[(unsigned char) tolower(from[i])] = to[i];
         }
-        rc[s.length() - 1 - i] = c;
     }
+
+    const char *from = "ACGT";
+    const char *to   = "TGCA";
+    for(size_t i = 0; i < 4; i++) {
+        table[(unsigned char) from[i]] = to[i];
+        table[(unsigned char) tolower(from[i])] = to[i];
+    }
+    return table;
+}
+
+/**
+ * Scalar reverse complement through a complement table
+ */
+static void reverse_complement_table(const char *s, size_t len, char *rc, const array<char, 256> &table){
+    for(size_t i = 0; i < len; i++) {
+        char c = table[(unsigned char) s[i]];
+        if(c == 0) {
+            cerr << "reverse_complement(): Unknown nucleotide '" << s[i] << "'!" << endl;
+            exit(EXIT_FAILURE);
+        }
+        rc[len - 1 - i] = c;
+    }
+}
+
+#ifdef USTAR_HAVE_SSSE3_KERNEL
+/**
+ * Reverse complement 16 bytes at a time with pshufb.
+ * Blocks that are not only made of ACGT go through the table.
+ */
+__attribute__((target("ssse3")))
+static void reverse_complement_ssse3(const char *s, size_t len, char *rc, const array<char, 256> &table){
+    // indexed by the low nibble: A = 0x41, C = 0x43, G = 0x47, T = 0x54 (same for lowercase)
+    const __m128i complement = _mm_setr_epi8(0, 'T', 0, 'G', 'A', 0, 0, 'C', 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    const __m128i to_upper = _mm_set1_epi8((char) 0xDF);
+
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16){
+        // the last block of s is the first block of rc
+        const char *block_start = s + len - i - 16;
+        __m128i block = _mm_loadu_si128((const __m128i *) block_start);
+
+        __m128i upper = _mm_and_si128(block, to_upper);
+        __m128i acgt = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(upper, _mm_set1_epi8('A')), _mm_cmpeq_epi8(upper, _mm_set1_epi8('C'))),
+                _mm_or_si128(_mm_cmpeq_epi8(upper, _mm_set1_epi8('G')), _mm_cmpeq_epi8(upper, _mm_set1_epi8('T'))));
+        if(_mm_movemask_epi8(acgt) != 0xFFFF) {
+            reverse_complement_table(block_start, 16, rc + i, table);
+            continue;
+        }
+
+        __m128i comp = _mm_shuffle_epi8(complement, _mm_and_si128(block, low_nibble));
+        _mm_storeu_si128((__m128i *) (rc + i), _mm_shuffle_epi8(comp, reverse));
+    }
+    // the first len - i characters of s are left
+    reverse_complement_table(s, len - i, rc + i, table);
+}
+#endif
+
+string DBG::reverse_complement(const string &s) {
+    string rc(s.length(), '\0');
+    reverse_complement(s.data(), s.length(), &rc[0]);
     return rc;
 }
 
-void DBG::to_bcalm_file(const string &file_name) {
-    ofstream file;
-    file.open(file_name);
+void DBG::reverse_complement(const char *s, size_t len, char *rc) {
+    static const array<char, 256> tables[] = {
+            make_complement_table(ambiguity_policy_t::STRICT),
+            make_complement_table(ambiguity_policy_t::IUPAC),
+            make_complement_table(ambiguity_policy_t::TO_N)
+    };
+    const array<char, 256> &table = tables[(int) ambiguity_policy];
 
-    int id = 0;
-    for(const auto &node : nodes){
-        // >3 LN:i:33 ab:Z:2 2 3    L:+:138996:+
-        // CAAAACCAGACATAATAAAAATACTAATTAATG
-        file << ">" << id++ << " LN:i:" << node.length << " ab:Z:";
+#ifdef USTAR_HAVE_SSSE3_KERNEL
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    if(has_ssse3) {
+        reverse_complement_ssse3(s, len, rc, table);
+        return;
+    }
+#endif
+    reverse_complement_table(s, len, rc, table);
+}
+
+void DBG::serialize_bcalm_record(node_idx_t node_id, string &buffer) {
+    serialize_record(nodes[node_id], get_unitig(node_id), node_id, unitig_format_t::BCALM2, kmer_size, buffer);
+}
+
+void DBG::serialize_header(unitig_format_t format, string &buffer) {
+    if(format == unitig_format_t::GFA)
+        buffer += "H\tVN:Z:1.0\n";
+}
+
+void DBG::serialize_record(const node_t &node, string_view unitig, size_t id, unitig_format_t format, uint32_t kmer_size, string &buffer) {
+    if(format == unitig_format_t::GFA){
+        // S	3	CAAAACCAGACATAATAAAAATACTAATTAATG	LN:i:33	KC:i:7	km:f:2.3
+        // L	3	+	138996	+	30M
+        buffer += "S\t";
+        append_number(buffer, id);
+        buffer += '\t';
+        buffer += unitig;
+        buffer += "\tLN:i:";
+        append_number(buffer, unitig.length());
+        uint64_t kmer_count = 0;
         for(auto &ab : node.abundances)
-            file << ab << " ";
-        for(auto &arcs : node.arcs)
-            file << "L:" << (arcs.forward ? "+" : "-") << ":" << arcs.successor << ":" << (arcs.to_forward ? "+" : "-") << " ";
-        file << "\n" << node.unitig << "\n";
+            kmer_count += ab;
+        buffer += "\tKC:i:";
+        append_number(buffer, kmer_count);
+        buffer += "\tkm:f:";
+        append_number(buffer, node.average_abundance);
+        buffer += '\n';
+        for(auto &arcs : node.arcs){
+            buffer += "L\t";
+            append_number(buffer, id);
+            buffer += (arcs.forward ? "\t+\t" : "\t-\t");
+            append_number(buffer, arcs.successor);
+            buffer += (arcs.to_forward ? "\t+\t" : "\t-\t");
+            append_number(buffer, kmer_size - 1);
+            buffer += "M\n";
+        }
+        return;
+    }
+
+    // >3 LN:i:33 ab:Z:2 2 3    L:+:138996:+
+    // >3 ka:f:2.3    L:+:138996:+
+    // CAAAACCAGACATAATAAAAATACTAATTAATG
+    buffer += '>';
+    append_number(buffer, id);
+    if(format == unitig_format_t::BCALM2) {
+        buffer += " LN:i:";
+        append_number(buffer, node.length);
+        buffer += " ab:Z:";
+        for (auto &ab: node.abundances) {
+            append_number(buffer, ab);
+            buffer += ' ';
+        }
+    } else {
+        buffer += " ka:f:";
+        append_number(buffer, node.average_abundance);
+        buffer += ' ';
+    }
+    for(auto &arcs : node.arcs) {
+        buffer += (arcs.forward ? "L:+:" : "L:-:");
+        append_number(buffer, arcs.successor);
+        buffer += (arcs.to_forward ? ":+ " : ":- ");
+    }
+    buffer += '\n';
+    buffer += unitig;
+    buffer += '\n';
+}
+
+void DBG::to_bcalm_file(const string &file_name, unitig_format_t format) {
+    // records are formatted in the writer buffer, written one megabyte at a time
+    FastWriter file(file_name);
+
+    serialize_header(format, file.get_buffer());
+    for(size_t id = 0; id < nodes.size(); id++){
+        serialize_record(nodes[id], get_unitig(id), id, format, kmer_size, file.get_buffer());
+        file.commit();
     }
 
     file.close();
 }
 
-bool DBG::validate(){
+/**
+ * Compare two texts ignoring whitespaces
+ * @return true if they have the same tokens
+ */
+static bool same_tokens(const char *a, const char *a_end, const char *b, const char *b_end){
+    while(true){
+        while(a < a_end && isspace((unsigned char) *a)) a++;
+        while(b < b_end && isspace((unsigned char) *b)) b++;
+        if(a == a_end || b == b_end)
+            return a == a_end && b == b_end;
+
+        // compare one token
+        while(a < a_end && b < b_end && !isspace((unsigned char) *a) && !isspace((unsigned char) *b))
+            if(*a++ != *b++)
+                return false;
+        // tokens must end together
+        bool a_token_end = (a == a_end || isspace((unsigned char) *a));
+        bool b_token_end = (b == b_end || isspace((unsigned char) *b));
+        if(!a_token_end || !b_token_end)
+            return false;
+    }
+}
+
+/**
+ * Find the beginning of the next record, skipping comments
+ * @param p the beginning of a line
+ * @return pointer to the next '>' at the beginning of a line, or end
+ */
+static const char *next_record(const char *p, const char *end){
+    while(p < end && *p != '>'){
+        const char *nl = (const char *) memchr(p, '\n', end - p);
+        p = (nl == nullptr) ? end : nl + 1;
+    }
+    return p;
+}
+
+/**
+ * Skip the definition line and the sequence line of a record
+ * @param p the beginning of a record
+ * @return pointer past the sequence line
+ */
+static const char *end_of_record(const char *p, const char *end){
+    for(int line = 0; line < 2 && p < end; line++){
+        const char *nl = (const char *) memchr(p, '\n', end - p);
+        p = (nl == nullptr) ? end : nl + 1;
+    }
+    return p;
+}
+
+bool DBG::validate(unsigned n_threads) {
+    if(options.filtering()){
+        cerr << "validate(): The dBG was filtered at ingest, it can't be compared with " << bcalm_file_name << endl;
+        return false;
+    }
+    if(!original_ids.empty()){
+        cerr << "validate(): The dBG was reordered, it can't be compared with " << bcalm_file_name << endl;
+        return false;
+    }
+
+    MappedFile bcalm_dbg(bcalm_file_name);
+    if(!bcalm_dbg.good()){
+        cerr << "validate(): Can't map file " << bcalm_file_name << endl;
+        return false;
+    }
+    const char *begin = bcalm_dbg.data();
+    const char *end = begin + bcalm_dbg.size();
+
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+
+    // split the file in chunks of whole records, a few per thread for balancing
+    const size_t n_chunks = (size_t) n_threads * 4;
+    vector<const char *> chunk_starts;
+    chunk_starts.push_back(next_record(begin, end));
+    for(size_t c = 1; c < n_chunks; c++){
+        const char *p = begin + bcalm_dbg.size() / n_chunks * c;
+        if(p <= chunk_starts.back())
+            continue;
+        // move to the next record starting after p
+        const char *nl = (const char *) memchr(p - 1, '\n', end - p + 1);
+        p = (nl == nullptr) ? end : next_record(nl + 1, end);
+        if(p < end && p > chunk_starts.back())
+            chunk_starts.push_back(p);
+    }
+    chunk_starts.push_back(end);
+    size_t n_tasks = chunk_starts.size() - 1;
+
+    // first node of each chunk: count the records in the previous chunks
+    vector<size_t> first_node(n_tasks + 1, 0);
+    vector<size_t> first_mismatch(n_tasks, SIZE_MAX);
+    auto for_each_chunk = [&](const function<void(size_t)> &task){
+        atomic<size_t> next_chunk{0};
+        auto worker = [&](){
+            for(size_t c = next_chunk++; c < n_tasks; c = next_chunk++)
+                task(c);
+        };
+        vector<thread> threads;
+        for(unsigned t = 1; t < min((size_t) n_threads, n_tasks); t++)
+            threads.emplace_back(worker);
+        worker();
+        for(auto &th : threads)
+            th.join();
+    };
+
+    for_each_chunk([&](size_t c){
+        size_t n_records = 0;
+        for(const char *p = chunk_starts[c]; p < chunk_starts[c + 1]; n_records++)
+            p = next_record(end_of_record(p, chunk_starts[c + 1]), chunk_starts[c + 1]);
+        first_node[c + 1] = n_records;
+    });
+    for(size_t c = 0; c < n_tasks; c++)
+        first_node[c + 1] += first_node[c];
+
+    if(first_node[n_tasks] != nodes.size()){
+        cerr << "validate(): Files differ in the number of unitigs: " << first_node[n_tasks] << " != " << nodes.size() << endl;
+        return false;
+    }
+
+    // compare each record with the serialized node
+    for_each_chunk([&](size_t c){
+        string buffer; // reused for every node of the chunk
+        size_t node = first_node[c];
+        for(const char *p = chunk_starts[c]; p < chunk_starts[c + 1]; node++) {
+            const char *record_end = end_of_record(p, chunk_starts[c + 1]);
+
+            buffer.clear();
+            serialize_bcalm_record(node, buffer);
+            if(!same_tokens(p, record_end, buffer.data(), buffer.data() + buffer.size())){
+                first_mismatch[c] = node;
+                return;
+            }
+            p = next_record(record_end, chunk_starts[c + 1]);
+        }
+    });
+
+    for(size_t c = 0; c < n_tasks; c++)
+        if(first_mismatch[c] != SIZE_MAX){
+            cerr << "validate(): Files differ at unitig " << first_mismatch[c] << endl;
+            return false;
+        }
+    return true;
+}
+
+bool DBG::validate_through_file(){
     string fasta_dbg = "unitigs.k"+ to_string(kmer_size) +".ustar.fa";
     to_bcalm_file(fasta_dbg);
 
@@ -390,6 +1194,12 @@ bool DBG::verify_input(){
         cout << "OOPS! DBG is NOT an overlapping graph\n";
         good = false;
     }
+    if (verify_arc_symmetry() == 0)
+        cout << "YES! Every arc has its reverse!\n";
+    else {
+        cout << "OOPS! Some arcs have no reverse!\n";
+        good = false;
+    }
     if(validate())
         cout << "YES! DBG is the same as BCALM2 one!\n";
     else {
@@ -427,7 +1237,7 @@ void DBG::get_consistent_nodes_from(node_idx_t node, bool forward, vector<node_i
     }
 }
 
-string DBG::spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards) {
+void DBG::check_spell_args(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards) {
     if(path_nodes.size() != forwards.size()){
         cerr << "spell(): Inconsistent path!" << endl;
         exit(EXIT_FAILURE);
@@ -436,40 +1246,121 @@ string DBG::spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forw
         cerr << "spell(): You're not allowed to spell an empty path!" << endl;
         exit(EXIT_FAILURE);
     }
+}
 
-    string contig;
-    // first node as a seed
-    if(forwards[0])
-        contig = nodes.at(path_nodes[0]).unitig;
-    else
-        contig = reverse_complement(nodes.at(path_nodes[0]).unitig);
+size_t DBG::spell_length(const vector<node_idx_t> &path_nodes) {
+    if(path_nodes.empty())
+        return 0;
+
+    // every node after the first one shares kmer_size - 1 characters with its predecessor
+    size_t length = 0;
+    for(node_idx_t node : path_nodes)
+        length += get_unitig(node).length();
+    return length - (path_nodes.size() - 1) * (kmer_size - 1);
+}
+
+string DBG::spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards) {
+    check_spell_args(path_nodes, forwards);
+
+    // one allocation for the whole contig
+    string contig(spell_length(path_nodes), '\0');
+    spell(path_nodes, forwards, &contig[0]);
+
+    return contig;
+}
+
+size_t DBG::spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, char *buffer) {
+    check_spell_args(path_nodes, forwards);
+
+    char *out = buffer;
+    for(size_t i = 0; i < path_nodes.size(); i++){
+        string_view unitig = get_unitig(path_nodes.at(i));
+        // the first node is the seed, the others skip the overlap
+        size_t skip = (i == 0) ? 0 : kmer_size - 1;
+        size_t len = unitig.length() - skip;
+
+        if(forwards[i]) // last len characters
+            memcpy(out, unitig.data() + skip, len);
+        else // first len characters reverse-complemented
+            reverse_complement(unitig.data(), len, out);
+        out += len;
+    }
+
+    return out - buffer;
+}
+
+size_t DBG::spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, ostream &out) {
+    check_spell_args(path_nodes, forwards);
+
+    // reverse-complemented segments are written through this buffer, one chunk at a time
+    const size_t CHUNK_SIZE = 4096;
+    char rc_chunk[CHUNK_SIZE];
+
+    size_t written = 0;
+    for(size_t i = 0; i < path_nodes.size(); i++){
+        string_view unitig = get_unitig(path_nodes.at(i));
+        size_t skip = (i == 0) ? 0 : kmer_size - 1;
+        size_t len = unitig.length() - skip;
 
-    // extend the seed
-    for(size_t i = 1; i < path_nodes.size(); i++){
         if(forwards[i])
-            contig += nodes.at(path_nodes[i]).unitig.substr(kmer_size - 1);
+            out.write(unitig.data() + skip, (streamsize) len);
         else {
-            string unitig = nodes.at(path_nodes[i]).unitig;
-            size_t len = unitig.length() - (kmer_size - 1);
-            contig += reverse_complement(unitig.substr(0, len));
+            // walk the first len characters backward
+            for(size_t end = len; end > 0;){
+                size_t chunk = min(end, CHUNK_SIZE);
+                reverse_complement(unitig.data() + end - chunk, chunk, rc_chunk);
+                out.write(rc_chunk, (streamsize) chunk);
+                end -= chunk;
+            }
         }
+        written += len;
     }
 
-    return contig;
+    return written;
 }
 
 void DBG::get_counts(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, vector<uint32_t> &counts) {
+    // append to counts, growing it only once
+    size_t old_size = counts.size();
+    counts.resize(old_size + count_kmers(path_nodes));
+    get_counts(path_nodes, forwards, counts.data() + old_size);
+}
+
+size_t DBG::get_counts(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, uint32_t *counts) {
     //          3 5
     // forward: A C T T
     //          5 3
     // rev-com: A A G T
-    for (size_t i = 0; i < path_nodes.size(); i++)
+    uint32_t *out = counts;
+    for (size_t i = 0; i < path_nodes.size(); i++) {
+        const vector<uint32_t> &abundances = nodes.at(path_nodes[i]).abundances;
         if (forwards[i]) // read forward
-            for(uint32_t abundance : nodes.at(path_nodes[i]).abundances)
-                counts.push_back(abundance);
+            memcpy(out, abundances.data(), abundances.size() * sizeof(uint32_t));
         else // read backward
-            for(int k = int (nodes.at(path_nodes[i]).abundances.size() - 1); k > -1; k--)
-                counts.push_back(nodes.at(path_nodes[i]).abundances[k]);
+            reverse_counts(abundances.data(), abundances.size(), out);
+        out += abundances.size();
+    }
+    return out - counts;
+}
+
+size_t DBG::count_kmers(const vector<node_idx_t> &path_nodes) {
+    size_t n = 0;
+    for(node_idx_t node : path_nodes)
+        n += nodes.at(node).abundances.size();
+    return n;
+}
+
+void DBG::reverse_counts(const uint32_t *src, size_t n, uint32_t *dst) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // reverse 4 abundances at a time: the last block of src is the first block of dst
+    for(; i + 4 <= n; i += 4){
+        __m128i block = _mm_loadu_si128((const __m128i *) (src + n - i - 4));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_shuffle_epi32(block, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+#endif
+    for(; i < n; i++)
+        dst[i] = src[n - 1 - i];
 }
 
 bool DBG::check_path_consistency(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards) {
@@ -491,7 +1382,7 @@ bool DBG::check_path_consistency(const vector<node_idx_t> &path_nodes, const vec
 }
 
 uint32_t DBG::get_n_kmers() const {
-    return n_kmers;
+    return stats.n_kmers;
 }
 
 uint32_t DBG::get_n_nodes() const {
@@ -499,14 +1390,36 @@ uint32_t DBG::get_n_nodes() const {
 }
 
 const node_t & DBG::get_node(node_idx_t node){
+    if(options.lazy_sequences){
+        cerr << "DBG::get_node(): The unitigs are not in memory (lazy_sequences), use get_node_topology() and get_unitig()" << endl;
+        exit(EXIT_FAILURE);
+    }
     return nodes.at(node);
 }
 
+const node_t & DBG::get_node_topology(node_idx_t node) const {
+    return nodes.at(node);
+}
+
+string_view DBG::get_unitig(node_idx_t node) const {
+    if(options.lazy_sequences)
+        return {unitigs_file->data() + unitig_offsets.at(node), nodes[node].length};
+    return nodes.at(node).unitig;
+}
+
 uint32_t DBG::get_kmer_size() const {
     return kmer_size;
 }
 
 const vector<node_t> * DBG::get_nodes() {
+    if(options.lazy_sequences){
+        cerr << "DBG::get_nodes(): The unitigs are not in memory (lazy_sequences), use get_nodes_topology() and get_unitig()" << endl;
+        exit(EXIT_FAILURE);
+    }
+    return &nodes;
+}
+
+const vector<node_t> * DBG::get_nodes_topology() const {
     return &nodes;
 }
 
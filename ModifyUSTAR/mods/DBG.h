@@ -7,8 +7,14 @@
 #define USTAR_DBG_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <utility>
 #include <cstdint>
+#include "Stats.h"
 
 #define MAX_LINE_LEN 6000000
 
@@ -17,12 +23,87 @@ using namespace std;
 typedef uint32_t node_idx_t;
 // typedef size_t node_idx_t;
 
+/**
+ * How reverse_complement() treats bytes other than A, C, G, T
+ */
+enum class ambiguity_policy_t{
+    STRICT, // exit on anything but ACGT
+    IUPAC,  // complement IUPAC codes (N -> N, R <-> Y, ...), exit on anything else
+    TO_N    // turn anything but ACGT into N, never exit
+};
+
+/**
+ * Unitig file formats that can be written
+ */
+enum class unitig_format_t{
+    BCALM2,     // >0 LN:i:32 ab:Z:14 12 L:+:23:+
+    CUTTERFISH, // >0 ka:f:13.0 L:+:23:+ (Logan)
+    GFA         // GFA 1.0 segments and links
+};
+
+/**
+ * What verify_arc_symmetry() does with arcs that have no reverse counterpart
+ */
+enum class arc_repair_t{
+    NONE,           // only count them
+    ADD_MISSING,    // insert the missing reverse arcs
+    DROP_DANGLING   // remove the arcs without a reverse
+};
+
 struct arc_t{
     node_idx_t successor;
     bool forward;
     bool to_forward;
 };
 
+/**
+ * Order of the nodes in memory (see DBG::reorder_nodes())
+ */
+enum class node_order_t{
+    ORIGINAL,   // input order
+    BFS,        // breadth-first from each unvisited node, in input order
+    RCM,        // reverse Cuthill-McKee, one component at a time
+    COMPONENTS  // connected components contiguous, input order inside each component
+};
+
+struct node_t;
+
+/**
+ * How the dBG is built from the unitigs file
+ */
+struct parse_options_t{
+    // keep only where each unitig is in the input and read it from the mapped file when needed
+    bool lazy_sequences = false;
+
+    // drop unitigs at ingest: arcs to dropped unitigs are removed and the others renumbered
+    double min_average_abundance = 0;
+    uint32_t min_median_abundance = 0;
+    uint32_t min_length = 0;
+
+    // check that every arc has its reverse after parsing (verify_arc_symmetry()), and repair them unless NONE
+    bool check_arcs = false;
+    arc_repair_t arc_repair = arc_repair_t::NONE;
+
+    // renumber nodes after parsing so that traversals touch nearby memory
+    node_order_t node_order = node_order_t::ORIGINAL;
+
+    // write the statistics with dbg_stats_t::save_json() once the graph is built, if not empty
+    string stats_json_file_name;
+
+    /**
+     * @return true if some unitigs may be dropped
+     */
+    bool filtering() const{
+        return min_average_abundance > 0 || min_median_abundance > 0 || min_length > 0;
+    }
+
+    /**
+     * @param node a parsed node
+     * @return true if the node passes the filters
+     */
+    bool keep(const node_t &node) const;
+};
+
 struct node_t{
     uint32_t length;
     uint32_t median_abundance;
@@ -32,16 +113,21 @@ struct node_t{
     vector<arc_t> arcs;
 };
 
+class MappedFile;
+
 class DBG{
     string bcalm_file_name;
     uint32_t kmer_size = 0;
     vector<node_t> nodes;
-    size_t n_iso = 0;
-    size_t n_arcs = 0;
-    size_t n_kmers = 0;
-    double avg_unitig_len = 0;
-    double avg_abundances = 0;
+    dbg_stats_t stats; // accumulated by parse_bcalm_file()
     bool debug;
+    parse_options_t options;
+    size_t n_filtered = 0; // unitigs dropped at ingest
+    vector<uint64_t> unitig_offsets; // lazy_sequences only
+    vector<node_idx_t> original_ids; // input record of each node, empty if nodes are in input order
+    unique_ptr<MappedFile> unitigs_file; // lazy_sequences only
+    static ambiguity_policy_t ambiguity_policy;
+    static parse_options_t default_parse_options;
 
     /**
      * Parse the BCALM2 file
@@ -49,23 +135,56 @@ class DBG{
      */
     void parse_bcalm_file();
 
+    /**
+     * Parse the next record (definition line and sequence) of a BCALM2 or Cutterfish file
+     * @param bcalm_file the input file
+     * @param kmer_size the k-mer size
+     * @param expected_serial the ID this record must have
+     * @param line reusable line buffer
+     * @param node the record is written here, reusing its vectors
+     * @param file_offset if not null, the offset of the next line in the file; it's advanced past the record
+     * @return false if there are no more records
+     */
+    static bool parse_bcalm_record(istream &bcalm_file, uint32_t kmer_size, size_t expected_serial, string &line, node_t &node, uint64_t *file_offset=nullptr);
+
     /**
      * Check wether two adjacent node labels overlap
-     * @param node a dBG node
+     * @param node a dBG node ID
      * @param arcs a dBG arc
      * @return
      */
-    bool overlaps(const node_t &node, const arc_t &arcs);
+    bool overlaps(node_idx_t node, const arc_t &arcs);
+
+    /**
+     * Recompute the arc statistics (arcs, isolated nodes, degrees, components) after arcs changed
+     */
+    void recount_arc_stats();
+
+    /**
+     * Exit if the path can't be spelled
+     * @param path_nodes the path nodes
+     * @param forwards how nodes must be read
+     */
+    void check_spell_args(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards);
 
 public:
     /**
-     * Construct a de Bruijn Graph from a BCALM2 file
+     * Construct a de Bruijn Graph from a BCALM2 file, with the options of set_default_parse_options()
      * @param bcalm_file_name
      * @param kmer_size
      * @param debug
      */
     DBG(const string &bcalm_file_name, uint32_t kmer_size, bool debug=false);
 
+    /**
+     * Construct a de Bruijn Graph from a BCALM2 file
+     * @param bcalm_file_name
+     * @param kmer_size
+     * @param options how the graph is built
+     * @param debug
+     */
+    DBG(const string &bcalm_file_name, uint32_t kmer_size, const parse_options_t &options, bool debug=false);
+
     ~DBG();
 
     /**
@@ -73,23 +192,110 @@ public:
      */
     void print_stat();
 
+    /**
+     * Get the statistics collected while parsing, with their distributions
+     * @return the dBG statistics
+     */
+    const dbg_stats_t &get_stats() const;
+
     /**
      * Verify that if there is an arcs between two nodes then they share a k-1 substring
      * @return true if all nodes satisfies that condition
      */
     bool verify_overlaps();
 
+    /**
+     * Like verify_overlaps() but check all arcs in parallel and collect every violation
+     * @param violations arcs that don't overlap, as (node ID, arc index) pairs sorted by node
+     * @param n_threads number of threads (0 means one per hardware thread)
+     * @return the number of arcs that don't overlap
+     */
+    size_t verify_overlaps(vector<pair<node_idx_t, uint32_t>> &violations, unsigned n_threads=0);
+
+    /**
+     * Verify that every arc has its reverse counterpart (u + --> v + needs v - --> u -).
+     * Arcs are checked in parallel on a sorted edge list, not by per-node scans.
+     * @param repair what to do with the arcs without a reverse
+     * @param n_threads number of threads (0 means one per hardware thread)
+     * @return the number of arcs without a reverse (arcs to missing nodes included), before repairing
+     */
+    size_t verify_arc_symmetry(arc_repair_t repair=arc_repair_t::NONE, unsigned n_threads=0);
+
+    /**
+     * Permute the nodes so that neighbours are stored close to each other, and rewrite arc successors.
+     * get_original_id() maps the new IDs back to the input records.
+     * @param order the new order
+     */
+    void reorder_nodes(node_order_t order);
+
+    /**
+     * @param node a node ID
+     * @return the input record (0-based) the node was parsed from
+     */
+    node_idx_t get_original_id(node_idx_t node) const;
+
+    /**
+     * Write one "ID original_ID" line per node
+     * @param file_name the output file
+     */
+    void write_original_ids(const string &file_name) const;
+
     /**
      * Write a BCALM2 like file from dBG in memory
      * @param file_name fasta file name
+     * @param format the syntax of the output file
+     */
+    void to_bcalm_file(const string &file_name, unitig_format_t format=unitig_format_t::BCALM2);
+
+    /**
+     * Write the BCALM2 like entry of a node
+     * @param node the node ID
+     * @param buffer the entry (definition line and sequence) is appended here
      */
-    void to_bcalm_file(const string &file_name);
+    void serialize_bcalm_record(node_idx_t node, string &buffer);
 
     /**
-     * Compare BCALM2 file with to_bcalm_file()
+     * Convert a unitig file to another format one record at a time, without building the dBG.
+     * Memory is bounded by the largest record.
+     * @param in_file_name a BCALM2 or Cutterfish file
+     * @param out_file_name the converted file
+     * @param kmer_size the k-mer size
+     * @param format the syntax of the converted file
+     */
+    static void convert(const string &in_file_name, const string &out_file_name, uint32_t kmer_size, unitig_format_t format);
+
+    /**
+     * Write the entry of a node in any output format
+     * @param node the node
+     * @param unitig the node sequence
+     * @param id the node ID
+     * @param format the syntax of the entry
+     * @param kmer_size the k-mer size (GFA links overlap by kmer_size - 1)
+     * @param buffer the entry is appended here
+     */
+    static void serialize_record(const node_t &node, string_view unitig, size_t id, unitig_format_t format, uint32_t kmer_size, string &buffer);
+
+    /**
+     * Write what comes before the first entry (only GFA has a header)
+     * @param format the syntax of the file
+     * @param buffer the header is appended here
+     */
+    static void serialize_header(unitig_format_t format, string &buffer);
+
+    /**
+     * Compare BCALM2 file with the dBG in memory, without writing any file.
+     * Graphs filtered at ingest can't be compared with their input.
+     * The input is mapped in memory and compared in parallel, one chunk of records per task.
+     * @param n_threads number of threads (0 means one per hardware thread)
+     * @return true if the files are the same (spaces removed)
+     */
+    bool validate(unsigned n_threads=0);
+
+    /**
+     * Compare BCALM2 file with to_bcalm_file(), writing unitigs.k<k>.ustar.fa in the working directory
      * @return true if the files are the same (spaces removed)
      */
-    bool validate();
+    bool validate_through_file();
 
     /**
      * Compute the reverse complement
@@ -98,6 +304,26 @@ public:
      */
     static string reverse_complement(const string &s);
 
+    /**
+     * Choose how reverse_complement() handles non-ACGT bytes
+     * @param policy the new policy (default: ambiguity_policy_t::STRICT, as upstream USTAR)
+     */
+    static void set_ambiguity_policy(ambiguity_policy_t policy);
+
+    /**
+     * Choose the options of the graphs built without explicit ones, e.g. by upstream ustar
+     * @param options the new options (default: parse_options_t(), as upstream USTAR)
+     */
+    static void set_default_parse_options(const parse_options_t &options);
+
+    /**
+     * Compute the reverse complement without allocations
+     * @param s a nucleotide sequence
+     * @param len the length of s
+     * @param rc the reverse-complement of s is written here (must hold len characters and not overlap s)
+     */
+    static void reverse_complement(const char *s, size_t len, char *rc);
+
     /**
      * Get nodes reachable from node
      * @param node the current node ID
@@ -125,6 +351,31 @@ public:
      */
     string spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards);
 
+    /**
+     * Compute the length of the spell of this path without spelling it
+     * @param path_nodes the path nodes
+     * @return the number of nucleotides in the spell of the path
+     */
+    size_t spell_length(const vector<node_idx_t> &path_nodes);
+
+    /**
+     * Like spell() but write the spell directly into a buffer
+     * @param path_nodes the path nodes
+     * @param forwards how nodes must be read
+     * @param buffer the spell is written here (must hold spell_length() characters)
+     * @return the number of characters written
+     */
+    size_t spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, char *buffer);
+
+    /**
+     * Like spell() but write the spell directly to a stream, without building the contig
+     * @param path_nodes the path nodes
+     * @param forwards how nodes must be read
+     * @param out the spell is written here
+     * @return the number of characters written
+     */
+    size_t spell(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, ostream &out);
+
     /**
      * Check whether the path is path-consistent
      * @param path_nodes the nodes of the path
@@ -141,18 +392,81 @@ public:
      */
     void get_counts(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, vector<uint32_t> &counts);
 
+    /**
+     * Like get_counts() but write the abundances directly into a buffer,
+     * e.g. the per-simplitig counts the Encoder reads
+     * @param path_nodes the nodes of the path
+     * @param forwards how nodes must be read
+     * @param counts abundances are written here (must hold count_kmers() values)
+     * @return the number of abundances written
+     */
+    size_t get_counts(const vector<node_idx_t> &path_nodes, const vector<bool> &forwards, uint32_t *counts);
+
+    /**
+     * Count the kmers in the given path
+     * @param path_nodes the nodes of the path
+     * @return the number of abundances get_counts() would return
+     */
+    size_t count_kmers(const vector<node_idx_t> &path_nodes);
+
+    /**
+     * Copy n abundances in reverse order
+     * @param src abundances to read
+     * @param n how many abundances
+     * @param dst reversed abundances are written here (must not overlap src)
+     */
+    static void reverse_counts(const uint32_t *src, size_t n, uint32_t *dst);
+
+    /**
+     * Compute the median of a node's abundances in linear time
+     * @param abundances the abundances
+     * @param min_abundance the smallest abundance
+     * @param max_abundance the largest abundance
+     * @return the n/2-th smallest abundance, like median()
+     */
+    static uint32_t median_abundance(const vector<uint32_t> &abundances, uint32_t min_abundance, uint32_t max_abundance);
+
     uint32_t get_n_kmers() const;
 
     uint32_t get_n_nodes() const;
 
     bool verify_input();
 
+    /**
+     * Get a node. Not available with lazy_sequences, whose nodes have no unitig: the program stops
+     * @param node the node ID
+     * @return the node
+     */
     const node_t &get_node(node_idx_t node);
 
+    /**
+     * Get a node for its arcs, length and abundances. With lazy_sequences its unitig is empty: use get_unitig()
+     * @param node the node ID
+     * @return the node
+     */
+    const node_t &get_node_topology(node_idx_t node) const;
+
+    /**
+     * Get the sequence of a node, from memory or from the mapped input with lazy_sequences
+     * @param node the node ID
+     * @return the unitig
+     */
+    string_view get_unitig(node_idx_t node) const;
+
     uint32_t get_kmer_size() const;
 
+    /**
+     * Get every node. Not available with lazy_sequences, whose nodes have no unitig: the program stops
+     * @return the nodes
+     */
     const vector<node_t> *get_nodes();
 
+    /**
+     * Get every node for its arcs, length and abundances. With lazy_sequences the unitigs are empty: use get_unitig()
+     * @return the nodes
+     */
+    const vector<node_t> *get_nodes_topology() const;
+
     size_t estimate_n_nodes();
 };
 
@@ -9,6 +9,13 @@
 #include <map>
 #include <cstdint>
 #include "consts.h"
+#include "RLE.h"
+#include "Flip.h"
+#include "RadixSort.h"
+#include "Quantize.h"
+#include "BWT.h"
+#include "CountsFile.h"
+#include "BlockedCounts.h"
 using namespace std;
 
 class Encoder{
@@ -30,25 +37,157 @@ class Encoder{
 
     vector<uint32_t> compacted_counts;
 
+    vector<vector<uint32_t>> quantized_counts; // simplitigs_counts points here once quantized
+    double quantization_bound = 0; // 0 for exact counts
+    quantization_error_t quantization_error;
+
+    unsigned n_threads = 0; // for the parallel steps, 0 means one per hardware thread
+
     long bwt_primary_index = 0;
+    size_t bwt_block_size = 0; // 0 means one block
+    vector<uint64_t> bwt_primary_indices; // one per block
 
+    /**
+     * Run-length encode the counts in simplitigs_order (flipped simplitigs backwards), in parallel
+     */
     void do_RLE();
 
+    /**
+     * The serial RLE of upstream USTAR, renamed at build time: do_RLE() must give the same symbols and runs
+     */
+    void do_RLE_serial();
+
+    /**
+     * @return the counts stream, one segment per simplitig in simplitigs_order
+     */
+    vector<counts_segment_t> get_counts_segments() const;
+
     void compute_avg();
 
+    /**
+     * Sort simplitigs_order by avg_counts with radix_sort_by_key(), in parallel: the order of upstream's
+     * comparison sort, equal averages keep their relative order
+     */
+    void sort_by_average();
+
+    /**
+     * Choose the flips in parallel with choose_flips(), the ones leaving the fewest runs at simplitig boundaries
+     */
     void do_flip();
 
+    /**
+     * The serial flip of upstream USTAR, renamed at build time
+     */
+    void do_flip_serial();
+
     void compact_counts();
 
+    /**
+     * Replace compacted_counts with its BWT (SA-IS, linear time), in blocks of bwt_block_size if set.
+     * Its primary indices follow the convention of bwt_transform(), only the binary container stores them.
+     */
+    void do_BWT();
+
+    /**
+     * Which transform the BWT case of encode() runs: do_BWT() when the counts go to the binary container, the upstream
+     * one for the text file, which keeps its format. Blocks can't be written to the text file.
+     * @return true for do_BWT()
+     */
+    bool bwt_for_binary_counts() const;
+
+    /**
+     * The encode() of upstream USTAR, renamed at build time
+     */
+    void encode_upstream(encoding_t encoding_type);
+
+    /**
+     * The text counts writer of upstream USTAR, renamed at build time
+     */
+    void to_counts_file_text(const string &file_name);
+
 public:
     Encoder(const vector<string> *simplitigs, const vector<vector<uint32_t>> *simplitigs_counts, bool debug=false);
 
+    /**
+     * Encode the counts, quantized first after set_default_quantization(), with the encoding given by
+     * choose_encoding() after set_auto_encoding(true)
+     * @param encoding_type the encoding
+     */
     void encode(encoding_t encoding_type);
 
+    /**
+     * Make every encode() choose its encoding (ustar --auto-encoding)
+     * @param auto_encoding true to choose
+     */
+    static void set_auto_encoding(bool auto_encoding);
+
+    /**
+     * Lossy mode: replace the counts with their bin representatives before encoding, so that runs get longer.
+     * Must be called before encode(). The error introduced is printed and stored in the .counts header.
+     * The counts are quantized in a copy, held by the Encoder next to the caller's: they take twice the memory.
+     * @param quantizer the bins
+     */
+    void set_quantization(const Quantizer &quantizer);
+
+    /**
+     * Make every encode() quantize the counts first, with set_quantization() (ustar --quantize)
+     * @param quantizer the bins
+     */
+    static void set_default_quantization(const Quantizer &quantizer);
+
+    const quantization_error_t &get_quantization_error() const;
+
+    /**
+     * Trial-encode a sample of the simplitigs with every encoding, in parallel and without debug output, and pick the smallest.
+     * The sample is made of windows of consecutive simplitigs spread over simplitigs_order, so that neighbours
+     * stay neighbours. The chosen encoding is stored in the .counts header like any other.
+     * @param sample_kmers k-mers to sample (everything if there are fewer)
+     * @param codec the codec the counts file will be written with
+     * @return the encoding with the smallest expected output
+     */
+    encoding_t choose_encoding(size_t sample_kmers=1 << 20, stream_codec_t codec=stream_codec_t::RANS);
+
+    /**
+     * Encode with the encoding given by choose_encoding()
+     */
+    void encode_auto(size_t sample_kmers=1 << 20, stream_codec_t codec=stream_codec_t::RANS);
+
+    /**
+     * Transform the counts in independent blocks, in parallel: memory is bounded by the block size.
+     * Binary counts container only (set_binary_counts()).
+     * @param block_size counts per block, 0 for a single block
+     */
+    void set_bwt_block_size(size_t block_size);
+
     void to_fasta_file(const string &file_name);
 
+    /**
+     * Write the encoded counts: as text like upstream USTAR, or with to_binary_counts_file() after set_binary_counts()
+     * @param file_name the output file
+     */
     void to_counts_file(const string &file_name);
 
+    /**
+     * Make every to_counts_file() write a binary container (ustar --binary-counts[=codec])
+     * @param codec how streams are coded
+     */
+    static void set_binary_counts(stream_codec_t codec);
+
+    /**
+     * Write the encoded counts in a binary .counts container (see CountsFile.h)
+     * @param file_name the output file
+     * @param codec how streams are coded
+     */
+    void to_binary_counts_file(const string &file_name, stream_codec_t codec=stream_codec_t::RANS);
+
+    /**
+     * Write the encoded counts in a block-indexed file (see BlockedCounts.h), readable at any k-mer or simplitig.
+     * Not available for BWT, whose blocks can't be decoded at an arbitrary position.
+     * @param file_name the output file
+     * @param block_kmers k-mers per block
+     */
+    void to_blocked_counts_file(const string &file_name, uint32_t block_kmers=1 << 16);
+
     void print_stat();
 };
 #endif //USTAR_ENCODER_H
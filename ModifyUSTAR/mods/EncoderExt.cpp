@@ -0,0 +1,315 @@
+//
+// Encoder members added by the mods, the upstream ones are in Encoder.cpp
+//MOD
+//
+
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include "Encoder.h"
+
+// set by set_binary_counts(), for every Encoder
+static bool binary_counts = false;
+static stream_codec_t binary_counts_codec = stream_codec_t::RANS;
+// set by set_auto_encoding()
+static bool auto_encoding = false;
+// set by set_default_quantization()
+static unique_ptr<Quantizer> default_quantizer;
+
+vector<counts_segment_t> Encoder::get_counts_segments() const {
+    size_t n_simplitigs = simplitigs_counts->size();
+    vector<counts_segment_t> segments;
+    segments.reserve(n_simplitigs);
+    for(size_t i = 0; i < n_simplitigs; i++){
+        size_t simplitig = simplitigs_order.empty() ? i : simplitigs_order[i];
+        const vector<uint32_t> &counts = (*simplitigs_counts)[simplitig];
+        bool flipped = !flips.empty() && flips[simplitig];
+        segments.push_back({counts.data(), counts.size(), flipped});
+    }
+    return segments;
+}
+
+void Encoder::do_RLE() {
+    vector<counts_segment_t> segments = get_counts_segments();
+    size_t n_counts = 0;
+    for(const counts_segment_t &segment : segments)
+        n_counts += segment.length;
+
+    symbols.clear();
+    runs.clear();
+    run_length_encode(segments, symbols, runs, n_threads);
+    avg_run = runs.empty() ? 0 : (double) n_counts / (double) runs.size();
+
+    if(debug){
+        // check against the serial encoder
+        vector<uint32_t> parallel_symbols, parallel_runs;
+        parallel_symbols.swap(symbols);
+        parallel_runs.swap(runs);
+        do_RLE_serial();
+        if(symbols != parallel_symbols || runs != parallel_runs){
+            cerr << "do_RLE(): Parallel and serial RLE differ!" << endl;
+            exit(EXIT_FAILURE);
+        }
+        avg_run = runs.empty() ? 0 : (double) n_counts / (double) runs.size();
+    }
+}
+
+void Encoder::sort_by_average() {
+    radix_sort_by_key(avg_counts, simplitigs_order, n_threads);
+
+    if(debug){
+        auto by_average = [this](size_t a, size_t b){ return avg_counts[a] < avg_counts[b]; };
+        if(!is_sorted(simplitigs_order.begin(), simplitigs_order.end(), by_average)){
+            cerr << "sort_by_average(): Simplitigs are not sorted!" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void Encoder::do_flip() {
+    size_t n_simplitigs = simplitigs_counts->size();
+    flips.assign(n_simplitigs, false);
+    vector<counts_segment_t> segments = get_counts_segments();
+    vector<uint32_t> first(segments.size()), last(segments.size());
+    for(size_t i = 0; i < segments.size(); i++){
+        first[i] = segments[i].length == 0 ? 0 : segments[i].counts[0];
+        last[i] = segments[i].length == 0 ? 0 : segments[i].counts[segments[i].length - 1];
+    }
+
+    vector<uint8_t> flipped;
+    choose_flips(first, last, flipped, n_threads);
+    for(size_t i = 0; i < flipped.size(); i++)
+        if(flipped[i])
+            flips[simplitigs_order.empty() ? i : simplitigs_order[i]] = true;
+
+    if(debug){
+        vector<uint8_t> serial_flipped;
+        choose_flips_serial(first, last, serial_flipped);
+        if(serial_flipped != flipped){
+            cerr << "do_flip(): Parallel and serial flips differ!" << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // check against the serial flip of upstream: the cost model must not lose runs
+        vector<bool> cost_model_flips(n_simplitigs, false);
+        cost_model_flips.swap(flips);
+        do_flip_serial();
+        vector<uint8_t> upstream_flipped(n_simplitigs, 0);
+        for(size_t i = 0; i < n_simplitigs; i++){
+            size_t simplitig = simplitigs_order.empty() ? i : simplitigs_order[i];
+            upstream_flipped[i] = simplitig < flips.size() && flips[simplitig];
+        }
+        flips.swap(cost_model_flips);
+
+        size_t upstream_runs = count_boundary_runs(first, last, upstream_flipped);
+        size_t cost_model_runs = count_boundary_runs(first, last, flipped);
+        cout << "do_flip(): runs at simplitig boundaries " << count_boundary_runs(first, last, {}) << " -> "
+             << upstream_runs << " (upstream), " << cost_model_runs << " (cost model)\n";
+        if(cost_model_runs > upstream_runs){
+            cerr << "do_flip(): The cost model flips leave more runs than upstream!" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void Encoder::do_BWT() {
+    if(compacted_counts.empty())
+        compact_counts();
+
+    // StreamingEncoder::finish() makes the same call
+    vector<uint32_t> bwt;
+    bwt_transform_blocks(compacted_counts, bwt_block_size, bwt, bwt_primary_indices, n_threads);
+    bwt_primary_index = bwt_primary_indices.empty() ? 0 : (long) bwt_primary_indices[0];
+    compacted_counts.swap(bwt);
+
+    if(debug)
+        cout << "do_BWT(): " << bwt_primary_indices.size() << " blocks, primary index " << bwt_primary_index << "\n";
+}
+
+bool Encoder::bwt_for_binary_counts() const {
+    if(binary_counts)
+        return true;
+    if(bwt_block_size > 0){
+        cerr << "Encoder::encode(): BWT blocks need the binary counts container (--binary-counts)" << endl;
+        exit(EXIT_FAILURE);
+    }
+    return false;
+}
+
+void Encoder::set_quantization(const Quantizer &quantizer) {
+    if(encoding_done || simplitigs_counts == &quantized_counts){
+        cerr << "Encoder::set_quantization(): The counts are already encoded or quantized" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    quantized_counts = *simplitigs_counts;
+    size_t n_simplitigs = quantized_counts.size();
+    unsigned n_workers = n_threads == 0 ? max(1u, thread::hardware_concurrency()) : n_threads;
+    vector<quantization_error_t> errors(n_workers);
+    vector<thread> threads;
+    for(unsigned t = 0; t < n_workers; t++)
+        threads.emplace_back([&, t](){
+            for(size_t i = n_simplitigs * t / n_workers; i < n_simplitigs * (t + 1) / n_workers; i++)
+                quantizer.quantize(quantized_counts[i].data(), quantized_counts[i].size(), errors[t]);
+        });
+    for(auto &th : threads)
+        th.join();
+
+    quantization_error = quantization_error_t();
+    for(const quantization_error_t &error : errors)
+        quantization_error.merge(error);
+    simplitigs_counts = &quantized_counts;
+    quantization_bound = quantizer.get_error_bound();
+
+    cout << "Quantization: " << quantizer.get_n_bins() << " bins, error bound " << quantizer.get_error_bound() << "\n";
+    cout << "Quantization: " << quantization_error.n_changed << " of " << quantization_error.n_counts
+         << " counts changed, max relative error " << quantization_error.max_relative
+         << ", mean relative error " << quantization_error.mean_relative()
+         << ", mean absolute error " << quantization_error.mean_absolute() << "\n";
+}
+
+const quantization_error_t &Encoder::get_quantization_error() const {
+    return quantization_error;
+}
+
+encoding_t Encoder::choose_encoding(size_t sample_kmers, stream_codec_t codec) {
+    static const encoding_t candidates[] = {encoding_t::PLAIN, encoding_t::RLE, encoding_t::AVG_RLE,
+                                            encoding_t::FLIP_RLE, encoding_t::AVG_FLIP_RLE, encoding_t::BWT};
+    static const char *names[] = {"PLAIN", "RLE", "AVG_RLE", "FLIP_RLE", "AVG_FLIP_RLE", "BWT"};
+    static const size_t WINDOW = 256; // simplitigs
+
+    // windows of consecutive simplitigs, evenly spaced
+    size_t n_simplitigs = simplitigs_counts->size();
+    size_t n_windows = (n_simplitigs + WINDOW - 1) / WINDOW;
+    size_t avg_window_kmers = n_windows == 0 ? 1 : max((size_t) 1, n_kmers / n_windows);
+    size_t stride = max((size_t) 1, n_windows / max((size_t) 1, sample_kmers / avg_window_kmers));
+    vector<string> sample_simplitigs;
+    vector<vector<uint32_t>> sample_counts;
+    size_t n_sampled_kmers = 0;
+    for(size_t w = 0; w < n_windows; w += stride)
+        for(size_t i = w * WINDOW; i < min(n_simplitigs, (w + 1) * WINDOW); i++){
+            size_t simplitig = simplitigs_order.empty() ? i : simplitigs_order[i];
+            sample_simplitigs.push_back((*simplitigs)[simplitig]);
+            sample_counts.push_back((*simplitigs_counts)[simplitig]);
+            n_sampled_kmers += sample_counts.back().size();
+        }
+
+    // the trials run in parallel, each with its share of the threads. They don't print: debug is off for them, which
+    // silences the mods; upstream encode() is assumed to print its progress under debug only as well
+    const size_t n_candidates = sizeof(candidates) / sizeof(candidates[0]);
+    unsigned trial_threads = max(1u, (n_threads == 0 ? thread::hardware_concurrency() : n_threads) / (unsigned) n_candidates);
+    vector<size_t> sizes(n_candidates);
+    vector<thread> threads;
+    for(size_t c = 0; c < n_candidates; c++)
+        threads.emplace_back([&, c](){
+            Encoder trial(&sample_simplitigs, &sample_counts, false);
+            trial.n_threads = trial_threads;
+            if(binary_counts)
+                trial.set_bwt_block_size(bwt_block_size);
+            trial.encode_upstream(candidates[c]);
+            if(trial.symbols.empty() && trial.compacted_counts.empty())
+                trial.compact_counts();
+            string payload;
+            encode_stream(trial.symbols, codec, payload);
+            encode_stream(trial.runs, codec, payload);
+            if(trial.symbols.empty())
+                encode_stream(trial.compacted_counts, codec, payload);
+            sizes[c] = payload.size();
+        });
+    for(auto &t : threads)
+        t.join();
+
+    size_t best = (size_t) (min_element(sizes.begin(), sizes.end()) - sizes.begin());
+    double scale = n_sampled_kmers == 0 ? 0 : (double) n_kmers / (double) n_sampled_kmers;
+    cout << "choose_encoding(): " << n_sampled_kmers << " k-mers sampled, expected bytes:";
+    for(size_t c = 0; c < n_candidates; c++)
+        cout << " " << names[c] << " " << (size_t) ((double) sizes[c] * scale);
+    cout << ", chosen " << names[best] << "\n";
+    return candidates[best];
+}
+
+void Encoder::encode_auto(size_t sample_kmers, stream_codec_t codec) {
+    encode_upstream(choose_encoding(sample_kmers, codec));
+}
+
+void Encoder::encode(encoding_t encoding_type) {
+    if(default_quantizer != nullptr && simplitigs_counts != &quantized_counts)
+        set_quantization(*default_quantizer);
+    if(auto_encoding)
+        encoding_type = choose_encoding(1 << 20, binary_counts_codec);
+    encode_upstream(encoding_type);
+}
+
+void Encoder::set_auto_encoding(bool auto_encoding) {
+    ::auto_encoding = auto_encoding;
+}
+
+void Encoder::set_default_quantization(const Quantizer &quantizer) {
+    default_quantizer.reset(new Quantizer(quantizer));
+}
+
+void Encoder::set_bwt_block_size(size_t block_size) {
+    bwt_block_size = block_size;
+}
+
+void Encoder::to_binary_counts_file(const string &file_name, stream_codec_t codec) {
+    if(symbols.empty() && compacted_counts.empty())
+        compact_counts();
+
+    counts_container_t container;
+    container.encoding = (uint32_t) encoding;
+    container.quantization_bound = (float) quantization_bound;
+    if(encoding == encoding_t::BWT){
+        // decode_counts() inverts the transform of do_BWT() only
+        if(bwt_primary_indices.empty() && !compacted_counts.empty()){
+            cerr << "Encoder::to_binary_counts_file(): The BWT was not computed by do_BWT()" << endl;
+            exit(EXIT_FAILURE);
+        }
+        container.bwt_block_size = bwt_block_size;
+        container.bwt_primary_indices = bwt_primary_indices;
+    }
+
+    // lend the streams to the container instead of copying them
+    symbols.swap(container.symbols);
+    runs.swap(container.runs);
+    bool lent_counts = container.symbols.empty();
+    if(lent_counts)
+        compacted_counts.swap(container.counts);
+    write_counts_container(file_name, container, codec);
+    symbols.swap(container.symbols);
+    runs.swap(container.runs);
+    if(lent_counts)
+        compacted_counts.swap(container.counts);
+}
+
+void Encoder::set_binary_counts(stream_codec_t codec) {
+    binary_counts = true;
+    binary_counts_codec = codec;
+}
+
+void Encoder::to_counts_file(const string &file_name) {
+    if(binary_counts)
+        to_binary_counts_file(file_name, binary_counts_codec);
+    else if(encoding == encoding_t::BWT && !bwt_primary_indices.empty()){
+        // upstream's text format has its own primary index convention
+        cerr << "Encoder::to_counts_file(): The BWT of do_BWT() can only be written to the binary container" << endl;
+        exit(EXIT_FAILURE);
+    } else
+        to_counts_file_text(file_name);
+}
+
+void Encoder::to_blocked_counts_file(const string &file_name, uint32_t block_kmers) {
+    if(encoding == encoding_t::BWT){
+        cerr << "Encoder::to_blocked_counts_file(): The BWT can't be decoded by block" << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(symbols.empty() && compacted_counts.empty())
+        compact_counts();
+
+    vector<uint32_t> simplitig_lengths;
+    simplitig_lengths.reserve(simplitigs_counts->size());
+    for(const counts_segment_t &segment : get_counts_segments())
+        simplitig_lengths.push_back((uint32_t) segment.length);
+    write_blocked_counts(file_name, symbols, runs, compacted_counts, simplitig_lengths, (uint32_t) encoding, block_kmers);
+}
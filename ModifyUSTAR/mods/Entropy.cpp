@@ -0,0 +1,292 @@
+//
+// Entropy coding of uint32_t streams: interleaved rANS over a small token alphabet
+//MOD
+//
+
+#include <vector>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Entropy.h"
+
+static const uint32_t SCALE_BITS = 12;
+static const uint32_t TOTAL_FREQ = 1u << SCALE_BITS;
+static const uint32_t RANS_L = 1u << 15; // states are in [RANS_L, 2^31)
+static const size_t N_STATES = 4;
+
+// values below DIRECT_TOKENS are their own token, the others are coded by bit length (7 to 32)
+static const uint32_t DIRECT_TOKENS = 64;
+static const size_t N_TOKENS = DIRECT_TOKENS + 32 - 7 + 1;
+
+static inline uint8_t token_of(uint32_t value, uint32_t &n_extra_bits){
+    uint32_t bits = 32 - __builtin_clz(value | 1);
+    bool direct = value < DIRECT_TOKENS;
+    n_extra_bits = direct ? 0 : bits - 1; // the leading 1 is implied
+    return (uint8_t) (direct ? value : DIRECT_TOKENS + bits - 7);
+}
+
+/**
+ * @return the value of a token without its extra bits
+ */
+static inline uint32_t token_base(size_t token, uint32_t &n_extra_bits){
+    n_extra_bits = token < DIRECT_TOKENS ? 0 : (uint32_t) (token - DIRECT_TOKENS + 7 - 1);
+    return token < DIRECT_TOKENS ? (uint32_t) token : 1u << n_extra_bits;
+}
+
+template<typename T>
+static void append_raw(string &out, T value){
+    out.append((const char *) &value, sizeof(T));
+}
+
+template<typename T>
+static bool read_raw(const char *&p, const char *end, T &value){
+    if((size_t) (end - p) < sizeof(T))
+        return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+/**
+ * Scale counts so that they sum to TOTAL_FREQ, every used token keeps a frequency of at least 1
+ */
+static void normalize_frequencies(const array<uint64_t, N_TOKENS> &counts, size_t n, array<uint32_t, N_TOKENS> &freq){
+    uint32_t sum = 0;
+    size_t largest = 0;
+    for(size_t t = 0; t < N_TOKENS; t++){
+        freq[t] = counts[t] == 0 ? 0 : max((uint32_t) 1, (uint32_t) (counts[t] * TOTAL_FREQ / n));
+        sum += freq[t];
+        if(counts[t] > counts[largest])
+            largest = t;
+    }
+    // the largest frequency is at least TOTAL_FREQ / N_TOKENS, it absorbs the rounding
+    freq[largest] += TOTAL_FREQ - sum;
+}
+
+void rans_encode(const uint32_t *values, size_t n, string &out){
+    if(n == 0)
+        return;
+
+    // tokens, and extra bits in reading order, 32 at a time
+    vector<uint8_t> tokens(n);
+    array<uint64_t, N_TOKENS> counts{};
+    array<array<uint64_t, N_TOKENS>, 4> partial_counts{}; // repeated tokens don't wait on the same counter
+    vector<uint32_t> extra;
+    uint64_t bit_buffer = 0;
+    uint32_t n_buffered = 0;
+    for(size_t i = 0; i < n; i++){
+        uint32_t n_extra_bits;
+        tokens[i] = token_of(values[i], n_extra_bits);
+        partial_counts[i % 4][tokens[i]]++;
+        bit_buffer |= (uint64_t) (values[i] & ((1ull << n_extra_bits) - 1)) << n_buffered;
+        n_buffered += n_extra_bits;
+        if(n_buffered >= 32){
+            extra.push_back((uint32_t) bit_buffer);
+            bit_buffer >>= 32;
+            n_buffered -= 32;
+        }
+    }
+    // the last word is always written: the decoder reads whole words
+    extra.push_back((uint32_t) bit_buffer);
+    for(const auto &partial : partial_counts)
+        for(size_t t = 0; t < N_TOKENS; t++)
+            counts[t] += partial[t];
+
+    array<uint32_t, N_TOKENS> freq{}, start{};
+    normalize_frequencies(counts, n, freq);
+    for(size_t t = 1; t < N_TOKENS; t++)
+        start[t] = start[t - 1] + freq[t - 1];
+
+    // x / freq as a 64 bit multiplication and a shift, exact for x < 2^31 (as in ryg_rans)
+    struct symbol_t{
+        uint32_t x_max;
+        uint32_t reciprocal;
+        uint32_t shift;
+        uint32_t bias;
+        uint32_t complement; // TOTAL_FREQ - freq
+    };
+    array<symbol_t, N_TOKENS> coder{};
+    for(size_t t = 0; t < N_TOKENS; t++){
+        if(freq[t] == 0)
+            continue;
+        symbol_t &symbol = coder[t];
+        symbol.x_max = ((RANS_L >> SCALE_BITS) << 16) * freq[t];
+        symbol.complement = TOTAL_FREQ - freq[t];
+        if(freq[t] < 2){
+            symbol.reciprocal = ~0u;
+            symbol.shift = 0;
+            symbol.bias = start[t] + TOTAL_FREQ - 1;
+        } else {
+            uint32_t s = 0;
+            while(freq[t] > (1u << s))
+                s++;
+            symbol.reciprocal = (uint32_t) (((1ull << (s + 31)) + freq[t] - 1) / freq[t]);
+            symbol.shift = s - 1;
+            symbol.bias = start[t];
+        }
+    }
+
+    // rANS works backwards: the decoder reads the words in reverse order
+    vector<uint16_t> words(n + 16);
+    size_t n_words = 0;
+    uint32_t states[N_STATES];
+    fill(states, states + N_STATES, RANS_L);
+    for(size_t i = n; i-- > 0;){
+        uint32_t &x = states[i % N_STATES];
+        const symbol_t &symbol = coder[tokens[i]];
+        if(x >= symbol.x_max){
+            words[n_words++] = (uint16_t) (x & 0xFFFF);
+            x >>= 16;
+        }
+        uint32_t q = (uint32_t) (((uint64_t) x * symbol.reciprocal) >> 32) >> symbol.shift;
+        x += symbol.bias + q * symbol.complement;
+    }
+    words.resize(n_words);
+    reverse(words.begin(), words.end());
+
+    // frequency table, extra bits, final states, words
+    uint8_t n_used = 0;
+    for(size_t t = 0; t < N_TOKENS; t++)
+        n_used += freq[t] > 0;
+    append_raw(out, n_used);
+    for(size_t t = 0; t < N_TOKENS; t++)
+        if(freq[t] > 0){
+            append_raw(out, (uint8_t) t);
+            append_raw(out, (uint16_t) freq[t]);
+        }
+    append_raw(out, (uint64_t) (extra.size() * sizeof(uint32_t)));
+    out.append((const char *) extra.data(), extra.size() * sizeof(uint32_t));
+    for(uint32_t x : states)
+        append_raw(out, x);
+    out.append((const char *) words.data(), words.size() * sizeof(uint16_t));
+}
+
+bool rans_decode(const char *data, size_t size, size_t n, uint32_t *values){
+    if(n == 0)
+        return true;
+    const char *p = data, *end = data + size;
+
+    struct slot_t{
+        uint32_t base;
+        uint16_t freq;
+        uint16_t start;
+        uint32_t n_extra_bits;
+    };
+    vector<slot_t> slots(TOTAL_FREQ);
+    uint8_t n_used;
+    if(!read_raw(p, end, n_used))
+        return false;
+    uint32_t start = 0;
+    for(uint8_t u = 0; u < n_used; u++){
+        uint8_t token;
+        uint16_t freq;
+        if(!read_raw(p, end, token) || !read_raw(p, end, freq) || token >= N_TOKENS || freq == 0 || start + freq > TOTAL_FREQ)
+            return false;
+        uint32_t n_extra_bits;
+        uint32_t base = token_base(token, n_extra_bits);
+        for(uint32_t s = start; s < start + freq; s++)
+            slots[s] = {base, freq, (uint16_t) start, n_extra_bits};
+        start += freq;
+    }
+    if(start != TOTAL_FREQ)
+        return false;
+
+    uint64_t extra_size;
+    if(!read_raw(p, end, extra_size) || extra_size > (uint64_t) (end - p) || extra_size % sizeof(uint32_t) != 0)
+        return false;
+    const char *extra = p, *extra_end = p + extra_size;
+    p += extra_size;
+
+    uint32_t states[N_STATES];
+    for(uint32_t &x : states)
+        if(!read_raw(p, end, x))
+            return false;
+    const char *words = p;
+    size_t n_words = (end - p) / sizeof(uint16_t), next_word = 0;
+
+    uint64_t bit_buffer = 0;
+    uint32_t n_buffered = 0;
+    auto decode_one = [&](uint32_t &x, uint32_t &value){
+        const slot_t &slot = slots[x & (TOTAL_FREQ - 1)];
+        x = slot.freq * (x >> SCALE_BITS) + (x & (TOTAL_FREQ - 1)) - slot.start;
+        if(x < RANS_L){
+            if(next_word == n_words)
+                return false;
+            uint16_t word;
+            memcpy(&word, words + next_word++ * sizeof(uint16_t), sizeof(uint16_t));
+            x = (x << 16) | word;
+        }
+
+        // extra bits (none for small values) without branches
+        if(n_buffered < 32 && extra != extra_end){
+            uint32_t word;
+            memcpy(&word, extra, sizeof(uint32_t));
+            extra += sizeof(uint32_t);
+            bit_buffer |= (uint64_t) word << n_buffered;
+            n_buffered += 32;
+        }
+        if(n_buffered < slot.n_extra_bits)
+            return false;
+        value = slot.base | (uint32_t) (bit_buffer & ((1ull << slot.n_extra_bits) - 1));
+        bit_buffer >>= slot.n_extra_bits;
+        n_buffered -= slot.n_extra_bits;
+        return true;
+    };
+
+    // the states stay in registers when the lanes are explicit
+    uint32_t x0 = states[0], x1 = states[1], x2 = states[2], x3 = states[3];
+    size_t i = 0;
+    for(; i + N_STATES <= n; i += N_STATES)
+        if(!decode_one(x0, values[i]) || !decode_one(x1, values[i + 1]) || !decode_one(x2, values[i + 2]) || !decode_one(x3, values[i + 3]))
+            return false;
+    states[0] = x0, states[1] = x1, states[2] = x2, states[3] = x3;
+    for(; i < n; i++)
+        if(!decode_one(states[i % N_STATES], values[i]))
+            return false;
+
+    // the encoder started from RANS_L
+    for(uint32_t x : states)
+        if(x != RANS_L)
+            return false;
+    return next_word == n_words;
+}
+
+size_t rans_max_values(const char *data, size_t size){
+    const char *p = data, *end = data + size;
+    uint8_t n_used;
+    if(!read_raw(p, end, n_used) || n_used == 0)
+        return 0;
+    uint32_t max_freq = 0, max_n_extra_bits = 0;
+    for(uint8_t u = 0; u < n_used; u++){
+        uint8_t token;
+        uint16_t freq;
+        if(!read_raw(p, end, token) || !read_raw(p, end, freq) || token >= N_TOKENS)
+            return 0;
+        uint32_t n_extra_bits;
+        token_base(token, n_extra_bits);
+        max_freq = max(max_freq, (uint32_t) freq);
+        max_n_extra_bits = max(max_n_extra_bits, n_extra_bits);
+    }
+    uint64_t extra_size;
+    if(!read_raw(p, end, extra_size) || extra_size > (uint64_t) (end - p))
+        return 0;
+    p += extra_size;
+    if((size_t) (end - p) < N_STATES * sizeof(uint32_t))
+        return 0;
+    size_t n_words = (size_t) (end - p - N_STATES * sizeof(uint32_t)) / sizeof(uint16_t);
+
+    if(max_freq >= TOTAL_FREQ){
+        // one token: only its extra bits take room
+        if(max_n_extra_bits == 0)
+            return SIZE_MAX;
+        return (size_t) (extra_size * 8 / max_n_extra_bits);
+    }
+    // a state x >= RANS_L becomes (x / freq) TOTAL_FREQ + x % freq + start >= x + floor(x / freq) > x (1 + 7 / (8 freq)),
+    // it starts from RANS_L and ends below 2^31, and every word takes 16 bits out of it
+    double bits = 16.0 * (double) n_words + (double) N_STATES * (31 - 15);
+    double min_bits_per_value = log2(1 + 7.0 / (8.0 * max_freq));
+    return (size_t) (bits / min_bits_per_value) + N_STATES;
+}
@@ -0,0 +1,44 @@
+//
+// Entropy coding of uint32_t streams: interleaved rANS over a small token alphabet
+//MOD
+//
+
+#ifndef USTAR_ENTROPY_H
+#define USTAR_ENTROPY_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Entropy code values with 4 interleaved rANS states (32 bit, 16 bit renormalization, 12 bit frequencies).
+ * Values below 64 are tokens of their own; larger values are coded as their bit length, followed by raw extra bits.
+ * @param values the values
+ * @param n the number of values
+ * @param out the coded stream is appended here (the frequency table is included)
+ */
+void rans_encode(const uint32_t *values, size_t n, string &out);
+
+/**
+ * Decode a stream written by rans_encode()
+ * @param data the coded stream
+ * @param size its size in bytes
+ * @param n the number of values to decode
+ * @param values decoded values are written here (n values)
+ * @return false if the stream is corrupted
+ */
+bool rans_decode(const char *data, size_t size, size_t n, uint32_t *values);
+
+/**
+ * Bound the number of values a stream written by rans_encode() can hold, to check a value count before allocating.
+ * Every value but those of a token with the whole frequency range makes the states grow, and the states and words
+ * hold a known number of bits; a single token of a value below 64 costs nothing, its values can't be bounded.
+ * @param data the coded stream
+ * @param size its size in bytes
+ * @return the bound (SIZE_MAX when there is none), 0 if the stream is corrupted
+ */
+size_t rans_max_values(const char *data, size_t size);
+
+#endif //USTAR_ENTROPY_H
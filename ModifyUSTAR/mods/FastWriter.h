@@ -0,0 +1,120 @@
+//
+// Buffered file writer: records are formatted in a large user-space buffer
+// and handed to the kernel one write() per megabyte
+//MOD
+//
+
+#ifndef USTAR_FASTWRITER_H
+#define USTAR_FASTWRITER_H
+
+#include <string>
+#include <charconv>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Append a number to a buffer with std::to_chars (shortest round-trip form for doubles)
+ * @param buffer the number is appended here
+ * @param value the number to write
+ */
+template<typename T>
+inline void append_number(string &buffer, T value){
+    char digits[32];
+    auto result = to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr - digits);
+}
+
+class FastWriter{
+    int fd = -1;
+    string file_name;
+    string buffer;
+    size_t flush_size;
+
+    void write_all(const char *data, size_t len){
+        while(len > 0){
+            ssize_t written = ::write(fd, data, len);
+            if(written < 0){
+                if(errno == EINTR)
+                    continue;
+                cerr << "FastWriter: Can't write file " << file_name << ": " << strerror(errno) << endl;
+                exit(EXIT_FAILURE);
+            }
+            data += written;
+            len -= written;
+        }
+    }
+
+public:
+    /**
+     * Open (and truncate) a file for writing
+     * @param file_name the file to write
+     * @param flush_size the buffer is written when it reaches this size
+     */
+    explicit FastWriter(const string &file_name, size_t flush_size=1 << 20) : file_name(file_name), flush_size(flush_size){
+        fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0){
+            cerr << "FastWriter: Can't open file " << file_name << ": " << strerror(errno) << endl;
+            exit(EXIT_FAILURE);
+        }
+        // one record may exceed flush_size: leave it some room
+        buffer.reserve(2 * flush_size);
+    }
+
+    FastWriter(const FastWriter &) = delete;
+    FastWriter &operator=(const FastWriter &) = delete;
+
+    ~FastWriter(){
+        close();
+    }
+
+    /**
+     * @return the buffer where the next records must be appended, then call commit()
+     */
+    string &get_buffer(){
+        return buffer;
+    }
+
+    /**
+     * Write the buffer if it's full enough
+     */
+    void commit(){
+        if(buffer.size() >= flush_size)
+            flush();
+    }
+
+    /**
+     * Write the whole buffer
+     */
+    void flush(){
+        write_all(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    /**
+     * Write a large block (e.g. a coded stream) after the buffer, without copying it
+     * @param data the bytes to write
+     * @param len how many
+     */
+    void write(const char *data, size_t len){
+        flush();
+        write_all(data, len);
+    }
+
+    /**
+     * Flush and close the file
+     */
+    void close(){
+        if(fd < 0)
+            return;
+        flush();
+        ::close(fd);
+        fd = -1;
+    }
+};
+
+#endif //USTAR_FASTWRITER_H
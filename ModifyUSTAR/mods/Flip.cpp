@@ -0,0 +1,238 @@
+//
+// Parallel choice of the simplitig orientations that save runs in the counts stream
+//MOD
+//
+
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Flip.h"
+
+// below this many simplitigs a single thread is faster
+static const size_t MIN_PARALLEL_SIMPLITIGS = 1 << 16;
+
+/*
+ * Boundary i (between simplitigs i - 1 and i) is coded on 4 bits: bit 2 p + s is set when a run starts there with
+ * simplitig i - 1 in orientation p and simplitig i in orientation s (1 means flipped).
+ * The minimum costs D0, D1 of the simplitigs up to i, with i in orientation 0 or 1, differ by at most one: the dynamic
+ * program only keeps D1 - D0 + 1, a state in 0..2, and steps through a table.
+ */
+static const unsigned N_STATES = 3;
+
+struct flip_step_t{
+    uint8_t next;       // next state
+    uint8_t from[2];    // best orientation of i - 1 for each orientation of i
+};
+
+struct flip_tables_t{
+    array<array<flip_step_t, 16>, N_STATES> steps{};
+
+    flip_tables_t(){
+        for(unsigned state = 0; state < N_STATES; state++)
+            for(unsigned code = 0; code < 16; code++){
+                int d[2] = {0, (int) state - 1};
+                int best[2];
+                for(unsigned s = 0; s < 2; s++){
+                    int cost0 = d[0] + (int) ((code >> s) & 1), cost1 = d[1] + (int) ((code >> (2 + s)) & 1);
+                    steps[state][code].from[s] = cost1 < cost0; // ties keep the previous simplitig unflipped
+                    best[s] = min(cost0, cost1);
+                }
+                steps[state][code].next = (uint8_t) (best[1] - best[0] + 1);
+            }
+    }
+};
+
+static const flip_tables_t &flip_tables(){
+    static const flip_tables_t tables;
+    return tables;
+}
+
+/**
+ * Code the boundaries [begin, end), begin > 0
+ */
+static void code_boundaries(const uint32_t *first, const uint32_t *last, size_t begin, size_t end, uint8_t *codes){
+    size_t i = begin;
+#if defined(__SSE2__)
+    for(; i + 4 <= end; i += 4){
+        __m128i f = _mm_loadu_si128((const __m128i *) (first + i));
+        __m128i l = _mm_loadu_si128((const __m128i *) (last + i));
+        __m128i prev_f = _mm_loadu_si128((const __m128i *) (first + i - 1));
+        __m128i prev_l = _mm_loadu_si128((const __m128i *) (last + i - 1));
+        // equalities, one bit per boundary: the previous written last count against the written first count
+        unsigned equal[4] = {
+                (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(prev_l, f))),        // 0 0
+                (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(prev_l, l))),        // 0 1
+                (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(prev_f, f))),        // 1 0
+                (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(prev_f, l)))};       // 1 1
+        for(unsigned k = 0; k < 4; k++){
+            uint8_t code = 0;
+            for(unsigned bit = 0; bit < 4; bit++)
+                code |= (uint8_t) ((~equal[bit] >> k & 1) << bit);
+            codes[i + k] = code;
+        }
+    }
+#endif
+    for(; i < end; i++)
+        codes[i] = (uint8_t) ((last[i - 1] != first[i]) | (last[i - 1] != last[i]) << 1
+                              | (first[i - 1] != first[i]) << 2 | (first[i - 1] != last[i]) << 3);
+}
+
+/**
+ * Forward pass over the boundaries [begin, end)
+ * @param state the state of simplitig begin - 1
+ * @param from if not null, the best orientations of i - 1 given i are stored in from[i] (bit s for orientation s)
+ * @return the state of simplitig end - 1
+ */
+static unsigned forward(const uint8_t *codes, size_t begin, size_t end, unsigned state, uint8_t *from){
+    const flip_tables_t &tables = flip_tables();
+    for(size_t i = begin; i < end; i++){
+        const flip_step_t &step = tables.steps[state][codes[i]];
+        if(from != nullptr)
+            from[i] = (uint8_t) (step.from[0] | step.from[1] << 1);
+        state = step.next;
+    }
+    return state;
+}
+
+/**
+ * Backtrack over the simplitigs [begin, end)
+ * @param orientation the orientation of simplitig end - 1
+ * @param flipped if not null, the orientations are stored there
+ * @return the orientation of simplitig begin - 1 (meaningless for begin = 0)
+ */
+static unsigned backward(const uint8_t *from, size_t begin, size_t end, unsigned orientation, uint8_t *flipped){
+    for(size_t i = end; i-- > begin;){
+        if(flipped != nullptr)
+            flipped[i] = (uint8_t) orientation;
+        orientation = i == 0 ? 0 : (from[i] >> orientation) & 1;
+    }
+    return orientation;
+}
+
+/**
+ * @return the best orientation of the last simplitig, given its state
+ */
+static unsigned last_orientation(unsigned state){
+    return state == 0; // D1 < D0
+}
+
+void choose_flips_serial(const vector<uint32_t> &first, const vector<uint32_t> &last, vector<uint8_t> &flipped){
+    size_t n = first.size();
+    flipped.assign(n, 0);
+    if(n == 0)
+        return;
+    vector<uint8_t> codes(n), from(n);
+    for(size_t i = 1; i < n; i++)
+        codes[i] = (uint8_t) ((last[i - 1] != first[i]) | (last[i - 1] != last[i]) << 1
+                              | (first[i - 1] != first[i]) << 2 | (first[i - 1] != last[i]) << 3);
+    // both orientations of the first simplitig cost nothing
+    unsigned state = forward(codes.data(), 1, n, 1, from.data());
+    backward(from.data(), 0, n, last_orientation(state), flipped.data());
+}
+
+void choose_flips(const vector<uint32_t> &first, const vector<uint32_t> &last, vector<uint8_t> &flipped,
+                  unsigned n_threads){
+    size_t n = first.size();
+    flipped.assign(n, 0);
+    if(n == 0)
+        return;
+
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    if(n < MIN_PARALLEL_SIMPLITIGS)
+        n_threads = 1;
+    // simplitig 0 has no boundary: the blocks cover the boundaries 1..n-1
+    size_t n_blocks = n_threads;
+    vector<size_t> block_start(n_blocks + 1);
+    for(size_t b = 0; b <= n_blocks; b++)
+        block_start[b] = 1 + (n - 1) * b / n_blocks;
+    vector<uint8_t> codes(n), from(n);
+    vector<array<uint8_t, N_STATES>> exit_states(n_blocks);
+    vector<unsigned> entry_states(n_blocks), exit_orientations(n_blocks);
+    vector<array<uint8_t, 2>> entry_orientations(n_blocks);
+
+    auto run = [&](auto &&task){
+        vector<thread> threads;
+        for(size_t b = 1; b < n_blocks; b++)
+            threads.emplace_back(task, b);
+        task(0);
+        for(auto &t : threads)
+            t.join();
+    };
+
+    // the exit state of each block for every entry state (the first block is entered with state 1)
+    run([&](size_t b){
+        size_t begin = block_start[b], end = block_start[b + 1];
+        code_boundaries(first.data(), last.data(), begin, end, codes.data());
+        for(unsigned state = 0; state < N_STATES; state++)
+            exit_states[b][state] = (uint8_t) (b == 0 && state != 1 ? 0 : forward(codes.data(), begin, end, state, nullptr));
+    });
+    unsigned state = 1;
+    for(size_t b = 0; b < n_blocks; b++){
+        entry_states[b] = state;
+        state = exit_states[b][state];
+    }
+
+    // decisions given the real entry states, and where each orientation at the end of a block leads at its start
+    run([&](size_t b){
+        size_t begin = block_start[b], end = block_start[b + 1];
+        forward(codes.data(), begin, end, entry_states[b], from.data());
+        for(unsigned orientation = 0; orientation < 2; orientation++)
+            entry_orientations[b][orientation] = (uint8_t) (begin == end ? orientation
+                                                            : backward(from.data(), begin, end, orientation, nullptr));
+    });
+    unsigned orientation = last_orientation(state);
+    for(size_t b = n_blocks; b-- > 0;){
+        exit_orientations[b] = orientation;
+        orientation = entry_orientations[b][orientation];
+    }
+    flipped[0] = (uint8_t) orientation;
+
+    run([&](size_t b){
+        backward(from.data(), block_start[b], block_start[b + 1], exit_orientations[b], flipped.data());
+    });
+}
+
+size_t count_boundary_runs(const vector<uint32_t> &first, const vector<uint32_t> &last, const vector<uint8_t> &flipped){
+    size_t n = first.size();
+    if(n < 2)
+        return 0;
+    bool has_flips = !flipped.empty();
+    size_t runs = 0, i = 1;
+#if defined(__SSE2__)
+    // written first count of i against written last count of i - 1, 4 boundaries at a time
+    auto flip_mask = [&](size_t at){
+        uint32_t bytes;
+        memcpy(&bytes, flipped.data() + at, sizeof(uint32_t));
+        __m128i m = _mm_cvtsi32_si128((int) bytes);
+        m = _mm_unpacklo_epi16(_mm_unpacklo_epi8(m, m), _mm_unpacklo_epi8(m, m));
+        return _mm_cmpgt_epi32(m, _mm_setzero_si128());
+    };
+    auto select = [](__m128i mask, __m128i a, __m128i b){
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    };
+    for(; i + 4 <= n; i += 4){
+        __m128i f = _mm_loadu_si128((const __m128i *) (first.data() + i));
+        __m128i l = _mm_loadu_si128((const __m128i *) (last.data() + i));
+        __m128i prev_f = _mm_loadu_si128((const __m128i *) (first.data() + i - 1));
+        __m128i prev_l = _mm_loadu_si128((const __m128i *) (last.data() + i - 1));
+        __m128i written_first = f, written_last = prev_l;
+        if(has_flips){
+            written_first = select(flip_mask(i), l, f);
+            written_last = select(flip_mask(i - 1), prev_f, prev_l);
+        }
+        int equal = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(written_first, written_last)));
+        runs += 4 - __builtin_popcount(equal);
+    }
+#endif
+    for(; i < n; i++){
+        bool flip = has_flips && flipped[i], prev_flip = has_flips && flipped[i - 1];
+        runs += (flip ? last[i] : first[i]) != (prev_flip ? first[i - 1] : last[i - 1]);
+    }
+    return runs;
+}
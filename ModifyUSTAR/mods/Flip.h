@@ -0,0 +1,45 @@
+//
+// Parallel choice of the simplitig orientations that save runs in the counts stream
+//MOD
+//
+
+#ifndef USTAR_FLIP_H
+#define USTAR_FLIP_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Choose which simplitigs to read backwards so that the counts stream has as few runs as possible.
+ * The runs inside a simplitig are the same both ways, so the cost is the number of runs starting at simplitig
+ * boundaries (count_boundary_runs()), and it only depends on the orientations of neighbours: the minimum is found
+ * exactly by dynamic programming over the 2 orientations of each simplitig. The boundary costs are computed with SSE2,
+ * 4 boundaries at a time. The ordering is cut in one block per thread: each block first maps every state it may be
+ * entered with to the state it leaves with, a serial pass over the blocks gives the real ones, and the blocks then
+ * fill in their decisions in parallel. On equal costs a simplitig is not flipped.
+ * @param first first count of each simplitig, in output order
+ * @param last last count of each simplitig, in output order
+ * @param flipped 1 for the simplitigs to flip, in output order
+ * @param n_threads number of threads (0 means one per hardware thread)
+ */
+void choose_flips(const vector<uint32_t> &first, const vector<uint32_t> &last, vector<uint8_t> &flipped,
+                  unsigned n_threads=0);
+
+/**
+ * Reference serial implementation of choose_flips()
+ */
+void choose_flips_serial(const vector<uint32_t> &first, const vector<uint32_t> &last, vector<uint8_t> &flipped);
+
+/**
+ * The cost model of the flips: runs that start at a simplitig boundary
+ * @param first first count of each simplitig, in output order
+ * @param last last count of each simplitig, in output order
+ * @param flipped the orientations, empty if none is flipped
+ * @return the number of simplitigs (but the first) whose first written count differs from the previous last one
+ */
+size_t count_boundary_runs(const vector<uint32_t> &first, const vector<uint32_t> &last, const vector<uint8_t> &flipped);
+
+#endif //USTAR_FLIP_H
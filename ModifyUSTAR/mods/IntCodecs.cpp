@@ -0,0 +1,201 @@
+//
+// Byte-oriented integer codecs for the counts streams: LEB128, Stream VByte and frame of reference bit packing
+//MOD
+//
+
+#include <array>
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <tmmintrin.h>
+#define USTAR_HAVE_SSSE3_KERNEL
+#endif
+
+#include "IntCodecs.h"
+
+static const size_t FOR_BLOCK = 128;
+
+void varint_encode(const uint32_t *values, size_t n, string &out){
+    for(size_t i = 0; i < n; i++){
+        uint32_t x = values[i];
+        while(x >= 0x80){
+            out += (char) ((x & 0x7F) | 0x80);
+            x >>= 7;
+        }
+        out += (char) x;
+    }
+}
+
+bool varint_decode(const char *data, size_t size, size_t n, uint32_t *values){
+    const uint8_t *p = (const uint8_t *) data, *end = p + size;
+    for(size_t i = 0; i < n; i++){
+        // most counts and runs fit in one byte
+        if(p < end && *p < 0x80){
+            values[i] = *p++;
+            continue;
+        }
+        uint32_t x = 0;
+        for(unsigned shift = 0;; shift += 7){
+            if(p == end || shift > 28)
+                return false;
+            uint8_t byte = *p++;
+            x |= (uint32_t) (byte & 0x7F) << shift;
+            if(byte < 0x80)
+                break;
+        }
+        values[i] = x;
+    }
+    return p == end;
+}
+
+static inline uint32_t byte_length(uint32_t x){
+    return x < (1u << 8) ? 1 : x < (1u << 16) ? 2 : x < (1u << 24) ? 3 : 4;
+}
+
+void stream_vbyte_encode(const uint32_t *values, size_t n, string &out){
+    size_t n_control = (n + 3) / 4;
+    size_t control_start = out.size();
+    out.append(n_control, '\0');
+    for(size_t i = 0; i < n; i++){
+        uint32_t length = byte_length(values[i]);
+        out[control_start + i / 4] = (char) (out[control_start + i / 4] | (char) ((length - 1) << (2 * (i % 4))));
+        out.append((const char *) &values[i], length); // little endian
+    }
+}
+
+/**
+ * Byte lengths and shuffles of the 256 control bytes
+ */
+struct stream_vbyte_tables_t{
+    array<uint8_t, 256> lengths{};
+    array<array<uint8_t, 16>, 256> shuffles{};
+
+    stream_vbyte_tables_t(){
+        for(unsigned control = 0; control < 256; control++){
+            uint8_t byte = 0;
+            for(unsigned v = 0; v < 4; v++){
+                unsigned length = ((control >> (2 * v)) & 3) + 1;
+                for(unsigned b = 0; b < 4; b++)
+                    shuffles[control][4 * v + b] = b < length ? byte++ : 0x80; // 0x80 gives a zero byte
+            }
+            lengths[control] = byte;
+        }
+    }
+};
+
+static const stream_vbyte_tables_t &stream_vbyte_tables(){
+    static const stream_vbyte_tables_t tables;
+    return tables;
+}
+
+/**
+ * Decode groups of 4 values while 16 bytes can be read
+ * @return the number of groups decoded
+ */
+#ifdef USTAR_HAVE_SSSE3_KERNEL
+__attribute__((target("ssse3")))
+static size_t stream_vbyte_decode_ssse3(const uint8_t *control, size_t n_groups, const uint8_t *&p, const uint8_t *end,
+                                        uint32_t *values){
+    const stream_vbyte_tables_t &tables = stream_vbyte_tables();
+    size_t g = 0;
+    for(; g < n_groups && end - p >= 16; g++){
+        __m128i data = _mm_loadu_si128((const __m128i *) p);
+        __m128i shuffle = _mm_loadu_si128((const __m128i *) tables.shuffles[control[g]].data());
+        _mm_storeu_si128((__m128i *) (values + 4 * g), _mm_shuffle_epi8(data, shuffle));
+        p += tables.lengths[control[g]];
+    }
+    return g;
+}
+#endif
+
+bool stream_vbyte_decode(const char *data, size_t size, size_t n, uint32_t *values){
+    size_t n_control = (n + 3) / 4;
+    if(size < n_control)
+        return false;
+    const uint8_t *control = (const uint8_t *) data;
+    const uint8_t *p = control + n_control, *end = (const uint8_t *) data + size;
+
+    // whole groups with SIMD, but the last one (it may have less than 4 values)
+    size_t g = 0;
+#ifdef USTAR_HAVE_SSSE3_KERNEL
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    if(has_ssse3 && n >= 4)
+        g = stream_vbyte_decode_ssse3(control, n / 4 - (n % 4 == 0), p, end, values);
+#endif
+    for(size_t i = 4 * g; i < n; i++){
+        uint32_t length = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        if((size_t) (end - p) < length)
+            return false;
+        uint32_t x = 0;
+        memcpy(&x, p, length);
+        values[i] = x;
+        p += length;
+    }
+    // unused lengths of the last control byte are 0
+    return p == end && (n % 4 == 0 || control[n_control - 1] >> (2 * (n % 4)) == 0);
+}
+
+void for_encode(const uint32_t *values, size_t n, string &out){
+    for(size_t begin = 0; begin < n; begin += FOR_BLOCK){
+        size_t end = min(n, begin + FOR_BLOCK);
+        uint32_t min_value = *min_element(values + begin, values + end);
+        uint32_t max_delta = 0;
+        for(size_t i = begin; i < end; i++)
+            max_delta |= values[i] - min_value;
+        uint8_t bits = (uint8_t) (max_delta == 0 ? 0 : 32 - __builtin_clz(max_delta));
+        out.append((const char *) &min_value, sizeof(uint32_t));
+        out += (char) bits;
+
+        uint64_t buffer = 0;
+        uint32_t n_buffered = 0;
+        for(size_t i = begin; i < end; i++){
+            buffer |= (uint64_t) (values[i] - min_value) << n_buffered;
+            n_buffered += bits;
+            while(n_buffered >= 8){
+                out += (char) (buffer & 0xFF);
+                buffer >>= 8;
+                n_buffered -= 8;
+            }
+        }
+        if(n_buffered > 0)
+            out += (char) buffer;
+    }
+}
+
+bool for_decode(const char *data, size_t size, size_t n, uint32_t *values){
+    const uint8_t *p = (const uint8_t *) data, *end = p + size;
+    for(size_t begin = 0; begin < n; begin += FOR_BLOCK){
+        size_t length = min(n - begin, FOR_BLOCK);
+        uint32_t min_value;
+        if(end - p < 5)
+            return false;
+        memcpy(&min_value, p, sizeof(uint32_t));
+        uint8_t bits = p[4];
+        p += 5;
+        size_t packed_size = (length * bits + 7) / 8;
+        if(bits > 32 || (size_t) (end - p) < packed_size)
+            return false;
+
+        if(bits == 0){
+            fill(values + begin, values + begin + length, min_value);
+            continue;
+        }
+        // 8 bytes at a time hold any value, whatever its bit offset
+        uint64_t mask = (1ull << bits) - 1;
+        for(size_t i = 0; i < length; i++){
+            size_t bit = i * bits;
+            uint64_t word = 0;
+            if(bit / 8 + 8 <= packed_size)
+                memcpy(&word, p + bit / 8, 8);
+            else
+                memcpy(&word, p + bit / 8, packed_size - bit / 8);
+            values[begin + i] = min_value + (uint32_t) ((word >> (bit % 8)) & mask);
+        }
+        p += packed_size;
+    }
+    return p == end;
+}
+
+size_t for_max_values(size_t size){
+    return size / 5 * FOR_BLOCK;
+}
@@ -0,0 +1,66 @@
+//
+// Byte-oriented integer codecs for the counts streams: LEB128, Stream VByte and frame of reference bit packing
+//MOD
+//
+
+#ifndef USTAR_INTCODECS_H
+#define USTAR_INTCODECS_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * LEB128: 7 bits per byte, the high bit tells that more bytes follow (1 byte below 128)
+ * @param values the values to code
+ * @param n how many
+ * @param out the coded values are appended here
+ */
+void varint_encode(const uint32_t *values, size_t n, string &out);
+
+/**
+ * Decode n values coded by varint_encode()
+ * @return false if data is not exactly n values
+ */
+bool varint_decode(const char *data, size_t size, size_t n, uint32_t *values);
+
+/**
+ * Stream VByte: the byte lengths of 4 values (2 bits each) are packed in a control byte, all the control bytes come
+ * first, then the values with their leading zero bytes dropped. Decoding takes 4 values with one shuffle (SSSE3).
+ * @param values the values to code
+ * @param n how many
+ * @param out the coded values are appended here
+ */
+void stream_vbyte_encode(const uint32_t *values, size_t n, string &out);
+
+/**
+ * Decode n values coded by stream_vbyte_encode()
+ * @return false if data is not exactly n values
+ */
+bool stream_vbyte_decode(const char *data, size_t size, size_t n, uint32_t *values);
+
+/**
+ * Frame of reference: blocks of 128 values are stored as their minimum (4 bytes), a bit width (1 byte) and the
+ * differences from the minimum packed with that width
+ * @param values the values to code
+ * @param n how many
+ * @param out the coded values are appended here
+ */
+void for_encode(const uint32_t *values, size_t n, string &out);
+
+/**
+ * Decode n values coded by for_encode()
+ * @return false if data is not exactly n values
+ */
+bool for_decode(const char *data, size_t size, size_t n, uint32_t *values);
+
+/**
+ * Bound the number of values a stream written by for_encode() can hold, to check a value count before allocating
+ * @param size the size of the coded stream in bytes
+ * @return the bound: every block of up to 128 values costs at least its minimum and bit width
+ */
+size_t for_max_values(size_t size);
+
+#endif //USTAR_INTCODECS_H
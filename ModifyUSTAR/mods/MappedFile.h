@@ -0,0 +1,91 @@
+//
+// Read-only memory mapping of a whole file
+//MOD
+//
+
+#ifndef USTAR_MAPPEDFILE_H
+#define USTAR_MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+class MappedFile{
+    const char *mapped = nullptr;
+    size_t mapped_size = 0;
+
+public:
+    /**
+     * Map a file in memory
+     * @param file_name the file to map
+     * @param sequential hint the kernel that the file will be read front to back
+     */
+    explicit MappedFile(const string &file_name, bool sequential=true){
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if(fd < 0)
+            return;
+
+        struct stat st{};
+        if(fstat(fd, &st) == 0 && st.st_size > 0){
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(addr != MAP_FAILED){
+                mapped = (const char *) addr;
+                mapped_size = st.st_size;
+                madvise(addr, mapped_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile(){
+        if(mapped != nullptr)
+            munmap((void *) mapped, mapped_size);
+    }
+
+    /**
+     * Change the access pattern hint
+     * @param sequential true for front to back scans, false for random access
+     */
+    void advise(bool sequential){
+        if(mapped != nullptr)
+            madvise((void *) mapped, mapped_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+
+    /**
+     * Tell the kernel that the beginning of the file won't be read again, so its pages can be dropped
+     * @param up_to bytes from the beginning of the file (rounded down to a page)
+     * @return pointer to the first byte still resident
+     */
+    const char *release(size_t up_to){
+        size_t page = sysconf(_SC_PAGESIZE);
+        up_to = up_to / page * page;
+        if(mapped != nullptr && up_to > 0)
+            madvise((void *) mapped, up_to, MADV_DONTNEED);
+        return mapped + up_to;
+    }
+
+    /**
+     * @return true if the file is mapped (empty files are never mapped)
+     */
+    bool good() const{
+        return mapped != nullptr;
+    }
+
+    const char *data() const{
+        return mapped;
+    }
+
+    size_t size() const{
+        return mapped_size;
+    }
+};
+
+#endif //USTAR_MAPPEDFILE_H
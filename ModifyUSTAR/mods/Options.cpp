@@ -0,0 +1,183 @@
+//
+// Command line switches of the mods, taken off the command line before ustar's own parser sees them
+//MOD
+//
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "Options.h"
+#include "Encoder.h"
+#include "DBG.h"
+
+bool take_long_option(int &argc, char **argv, const string &name, string &value){
+    value.clear();
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg.compare(0, name.size(), name) != 0 || (arg.size() > name.size() && arg[name.size()] != '='))
+            continue;
+        if(arg.size() > name.size())
+            value = arg.substr(name.size() + 1);
+        // the other arguments move up, argv[argc] stays NULL
+        for(int j = i; j < argc; j++)
+            argv[j] = argv[j + 1];
+        argc--;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Find the value of one of ustar's own switches, without taking it: "-k 31" or "-k31"
+ * @return the value, empty if the switch is not given
+ */
+static string short_option_value(int argc, char **argv, const string &name){
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == name && i + 1 < argc)
+            return argv[i + 1];
+        if(arg.size() > name.size() && arg.compare(0, name.size(), name) == 0)
+            return arg.substr(name.size());
+    }
+    return "";
+}
+
+/**
+ * Scan the unitig files with qc_files() instead of compressing, print a line per file and stop
+ * @param file_names the unitig files, comma separated (ustar's -i file if empty)
+ * @param stats_json_file_name where to write the statistics of all the files merged, if not empty
+ */
+static void run_qc(int argc, char **argv, const string &file_names, const string &stats_json_file_name){
+    vector<string> files;
+    string list = file_names.empty() ? short_option_value(argc, argv, "-i") : file_names;
+    for(size_t begin = 0; begin <= list.size();){
+        size_t comma = min(list.find(',', begin), list.size());
+        if(comma > begin)
+            files.push_back(list.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    uint32_t kmer_size = (uint32_t) atoi(short_option_value(argc, argv, "-k").c_str());
+    if(files.empty() || kmer_size == 0){
+        cerr << "--qc: The k-mer size (-k) and the files (-i <file> or --qc=<file>,<file>...) are needed" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    vector<dbg_stats_t> stats;
+    size_t n_failed = qc_files(files, kmer_size, stats);
+    dbg_stats_t total;
+    for(size_t f = 0; f < files.size(); f++){
+        // files that can't be read were reported by qc_file(), and have no nodes
+        cout << files[f] << "\tnodes " << stats[f].n_nodes << "\tk-mers " << stats[f].n_kmers << "\tarcs " << stats[f].n_arcs
+             << "\tisolated " << stats[f].n_iso;
+        if(stats[f].n_nodes > 0)
+            cout << "\tavg length " << stats[f].avg_unitig_len() << "\tavg abundance " << stats[f].avg_abundances();
+        cout << "\n";
+        total.merge(stats[f]);
+    }
+    if(!stats_json_file_name.empty() && !total.save_json(stats_json_file_name)){
+        cerr << "--qc: Can't write the statistics to " << stats_json_file_name << endl;
+        exit(EXIT_FAILURE);
+    }
+    exit(n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+void take_mods_options(int &argc, char **argv){
+    string value;
+
+    stream_codec_t codec = stream_codec_t::RANS;
+    bool binary_counts = take_long_option(argc, argv, "--binary-counts", value);
+    if(binary_counts && !value.empty() && !parse_stream_codec(value, codec)){
+        cerr << "--binary-counts: Unknown codec " << value << " (raw, rans, varint, stream-vbyte or for)" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if(take_long_option(argc, argv, "--auto-encoding", value)){
+        // the choice is recorded in the header of the binary container, the text file has no place for it
+        Encoder::set_auto_encoding(true);
+        binary_counts = true;
+    }
+
+    if(binary_counts)
+        Encoder::set_binary_counts(codec);
+
+    if(take_long_option(argc, argv, "--ambiguity", value)){
+        if(value == "strict")
+            DBG::set_ambiguity_policy(ambiguity_policy_t::STRICT);
+        else if(value == "iupac")
+            DBG::set_ambiguity_policy(ambiguity_policy_t::IUPAC);
+        else if(value == "to-n")
+            DBG::set_ambiguity_policy(ambiguity_policy_t::TO_N);
+        else{
+            cerr << "--ambiguity: Unknown policy " << value << " (strict, iupac or to-n)" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // options of the graphs built by ustar
+    parse_options_t parse_options;
+    if(take_long_option(argc, argv, "--stats-json", value)){
+        if(value.empty()){
+            cerr << "--stats-json: The output file is missing, e.g. --stats-json=stats.json" << endl;
+            exit(EXIT_FAILURE);
+        }
+        parse_options.stats_json_file_name = value;
+    }
+    if(take_long_option(argc, argv, "--check-arcs", value)){
+        parse_options.check_arcs = true;
+        if(value == "repair")
+            parse_options.arc_repair = arc_repair_t::ADD_MISSING;
+        else if(value == "drop")
+            parse_options.arc_repair = arc_repair_t::DROP_DANGLING;
+        else if(!value.empty()){
+            cerr << "--check-arcs: Unknown repair " << value << " (repair or drop)" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(take_long_option(argc, argv, "--node-order", value)){
+        if(value == "original")
+            parse_options.node_order = node_order_t::ORIGINAL;
+        else if(value == "bfs")
+            parse_options.node_order = node_order_t::BFS;
+        else if(value == "rcm")
+            parse_options.node_order = node_order_t::RCM;
+        else if(value == "components")
+            parse_options.node_order = node_order_t::COMPONENTS;
+        else{
+            cerr << "--node-order: Unknown order " << value << " (original, bfs, rcm or components)" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    DBG::set_default_parse_options(parse_options);
+
+    if(take_long_option(argc, argv, "--qc", value))
+        run_qc(argc, argv, value, parse_options.stats_json_file_name);
+
+    if(take_long_option(argc, argv, "--quantize", value)){
+        // <bound>[,<base>]
+        size_t comma = value.find(',');
+        string bound_text = value.substr(0, comma), base_text = comma == string::npos ? "" : value.substr(comma + 1);
+        char *end;
+        double bound = strtod(bound_text.c_str(), &end);
+        if(bound_text.empty() || *end != '\0' || !(bound > 0 && bound < 1)){
+            cerr << "--quantize: The error bound must be a number in (0, 1), e.g. --quantize=0.1 or --quantize=0.34,2" << endl;
+            exit(EXIT_FAILURE);
+        }
+        if(base_text.empty())
+            Encoder::set_default_quantization(Quantizer::with_error_bound(bound));
+        else{
+            double base = strtod(base_text.c_str(), &end);
+            if(*end != '\0' || !(base > 1)){
+                cerr << "--quantize: The base must be a number greater than 1" << endl;
+                exit(EXIT_FAILURE);
+            }
+            Quantizer quantizer = Quantizer::with_base(base);
+            if(quantizer.get_error_bound() > bound){
+                cerr << "--quantize: Base " << base << " bins have a relative error up to " << quantizer.get_error_bound()
+                     << ", more than " << bound << endl;
+                exit(EXIT_FAILURE);
+            }
+            Encoder::set_default_quantization(quantizer);
+        }
+    }
+}
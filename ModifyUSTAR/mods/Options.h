@@ -0,0 +1,42 @@
+//
+// Command line switches of the mods, taken off the command line before ustar's own parser sees them
+//MOD
+//
+
+#ifndef USTAR_OPTIONS_H
+#define USTAR_OPTIONS_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * Take --name or --name=value off the command line
+ * @param argc the argument count, decremented when the switch is found
+ * @param argv the arguments, the switch is removed and argv[argc] stays NULL
+ * @param name the switch, with its dashes
+ * @param value the text after '=', empty if there is none
+ * @return true if the switch was given
+ */
+bool take_long_option(int &argc, char **argv, const string &name, string &value);
+
+/**
+ * Take every switch of the mods off the command line and apply it. The build inserts the call at the start of ustar's main().
+ *  --binary-counts[=codec]     write the counts in the binary container (codec raw, rans, varint, stream-vbyte or for)
+ *  --auto-encoding             choose the encoding with Encoder::choose_encoding(), implies --binary-counts
+ *  --ambiguity=<policy>        what reverse complements do with non-ACGT bytes: strict (default), iupac or to-n
+ *  --quantize=<bound>[,<base>] lossy counts with a relative error of at most bound: the widest bins
+ *                              (Quantizer::with_error_bound()), or log bins of the given base if they respect it
+ *  --check-arcs[=repair|drop]  count the arcs without a reverse once the dBG is built, and add their reverses or drop
+ *                              them (DBG::verify_arc_symmetry())
+ *  --node-order=<order>        renumber the nodes of the dBG once it is built: original (default), bfs, rcm or components
+ *                              (DBG::reorder_nodes())
+ *  --stats-json=<file>         write the statistics of the dBG (dbg_stats_t::save_json()) once it is built
+ *  --qc[=<file>,<file>...]     scan the unitig files (-i by default) with qc_files() instead of compressing, print a
+ *                              line per file and exit; --stats-json gets the statistics of all the files merged
+ * @param argc the argument count
+ * @param argv the arguments
+ */
+void take_mods_options(int &argc, char **argv);
+
+#endif //USTAR_OPTIONS_H
@@ -0,0 +1,107 @@
+//
+// Lossy counts: abundances are rounded to log-scale bins before encoding
+//MOD
+//
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "Quantize.h"
+
+void quantization_error_t::merge(const quantization_error_t &other){
+    n_counts += other.n_counts;
+    n_changed += other.n_changed;
+    max_relative = max(max_relative, other.max_relative);
+    sum_relative += other.sum_relative;
+    sum_absolute += other.sum_absolute;
+}
+
+/**
+ * @return the max relative error of r over the counts [lo, hi]
+ */
+static double bin_error(uint32_t lo, uint32_t hi, double r){
+    return max(fabs(r - lo) / lo, fabs(hi - r) / hi);
+}
+
+void Quantizer::add_bin(uint32_t lo, uint32_t hi){
+    // 2 lo hi / (lo + hi) gives the same relative error at both ends, the best integer is next to it
+    double best = 2.0 * lo * hi / ((double) lo + hi);
+    uint32_t below = max(lo, (uint32_t) floor(best)), above = min(hi, (uint32_t) ceil(best));
+    uint32_t representative = bin_error(lo, hi, below) <= bin_error(lo, hi, above) ? below : above;
+    bin_starts.push_back(lo);
+    representatives.push_back(representative);
+    bound = max(bound, bin_error(lo, hi, representative));
+}
+
+void Quantizer::build_table(){
+    table.resize(TABLE_SIZE);
+    table[0] = 0;
+    for(uint32_t count = 1; count < TABLE_SIZE; count++)
+        table[count] = quantize_large(count);
+}
+
+Quantizer Quantizer::with_error_bound(double max_relative_error){
+    if(!(max_relative_error > 0 && max_relative_error < 1)){
+        cerr << "Quantizer::with_error_bound(): The error bound must be in (0, 1)" << endl;
+        exit(EXIT_FAILURE);
+    }
+    Quantizer quantizer;
+    // the widest bin from lo: a representative at most lo (1 + e), counts up to representative / (1 - e)
+    for(uint64_t lo = 1; lo <= UINT32_MAX;){
+        double representative = floor((double) lo * (1 + max_relative_error));
+        uint64_t hi = min((uint64_t) UINT32_MAX, max(lo, (uint64_t) floor(representative / (1 - max_relative_error))));
+        quantizer.add_bin((uint32_t) lo, (uint32_t) hi);
+        lo = hi + 1;
+    }
+    quantizer.build_table();
+    return quantizer;
+}
+
+Quantizer Quantizer::with_base(double base){
+    if(!(base > 1)){
+        cerr << "Quantizer::with_base(): The base must be greater than 1" << endl;
+        exit(EXIT_FAILURE);
+    }
+    Quantizer quantizer;
+    uint64_t lo = 1;
+    for(double edge = base; lo <= UINT32_MAX; edge *= base){
+        uint64_t next = (uint64_t) min(ceil(edge), (double) UINT32_MAX + 1);
+        if(next <= lo)
+            continue;
+        quantizer.add_bin((uint32_t) lo, (uint32_t) (next - 1));
+        lo = next;
+    }
+    quantizer.build_table();
+    return quantizer;
+}
+
+double Quantizer::get_error_bound() const {
+    return bound;
+}
+
+size_t Quantizer::get_n_bins() const {
+    return bin_starts.size();
+}
+
+uint32_t Quantizer::quantize_large(uint32_t count) const {
+    if(count == 0)
+        return 0;
+    size_t bin = upper_bound(bin_starts.begin(), bin_starts.end(), count) - bin_starts.begin() - 1;
+    return representatives[bin];
+}
+
+void Quantizer::quantize(uint32_t *counts, size_t n, quantization_error_t &error) const {
+    error.n_counts += n;
+    for(size_t i = 0; i < n; i++){
+        uint32_t q = quantize(counts[i]);
+        if(q == counts[i])
+            continue;
+        double difference = fabs((double) q - counts[i]);
+        error.n_changed++;
+        error.sum_absolute += difference;
+        error.sum_relative += difference / counts[i];
+        error.max_relative = max(error.max_relative, difference / counts[i]);
+        counts[i] = q;
+    }
+}
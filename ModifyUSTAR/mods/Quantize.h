@@ -0,0 +1,88 @@
+//
+// Lossy counts: abundances are rounded to log-scale bins before encoding
+//MOD
+//
+
+#ifndef USTAR_QUANTIZE_H
+#define USTAR_QUANTIZE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * What quantization did to the counts
+ */
+struct quantization_error_t{
+    size_t n_counts = 0;
+    size_t n_changed = 0;
+    double max_relative = 0;    // max |q(x) - x| / x
+    double sum_relative = 0;
+    double sum_absolute = 0;
+
+    double mean_relative() const { return n_counts == 0 ? 0 : sum_relative / (double) n_counts; }
+
+    double mean_absolute() const { return n_counts == 0 ? 0 : sum_absolute / (double) n_counts; }
+
+    void merge(const quantization_error_t &other);
+};
+
+/**
+ * Maps every count to the representative of its bin. Bins grow geometrically, so small counts stay exact.
+ * The representative of [lo, hi] is the integer with the smallest max relative error over the bin.
+ */
+class Quantizer{
+    static const uint32_t TABLE_SIZE = 1 << 12; // counts below this are looked up directly
+
+    vector<uint32_t> bin_starts;
+    vector<uint32_t> representatives;
+    vector<uint32_t> table;
+    double bound = 0;
+
+    void add_bin(uint32_t lo, uint32_t hi);
+
+    void build_table();
+
+    Quantizer() = default;
+
+public:
+    /**
+     * Bins as wide as possible with a relative error of at most max_relative_error on every count:
+     * about log base (1 + e) / (1 - e)
+     * @param max_relative_error in (0, 1)
+     */
+    static Quantizer with_error_bound(double max_relative_error);
+
+    /**
+     * Bins [ceil(b^k), ceil(b^(k+1))), e.g. base 2 for log2 bins
+     * @param base b > 1
+     */
+    static Quantizer with_base(double base);
+
+    /**
+     * @return the max relative error of any count
+     */
+    double get_error_bound() const;
+
+    size_t get_n_bins() const;
+
+    uint32_t quantize(uint32_t count) const{
+        if(count < TABLE_SIZE)
+            return table[count];
+        return quantize_large(count);
+    }
+
+    uint32_t quantize_large(uint32_t count) const;
+
+    /**
+     * Quantize counts in place
+     * @param counts the counts
+     * @param n how many
+     * @param error the error is added here
+     */
+    void quantize(uint32_t *counts, size_t n, quantization_error_t &error) const;
+};
+
+#endif //USTAR_QUANTIZE_H
@@ -0,0 +1,190 @@
+//
+// Parallel run-length encoding of the counts stream
+//MOD
+//
+
+#include <algorithm>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "RLE.h"
+
+// below this many counts a single thread is faster
+static const size_t MIN_PARALLEL_COUNTS = 1 << 16;
+
+/**
+ * @return the first position in [begin, end) whose count is not x, end if there is none
+ */
+static size_t forward_run_end(const uint32_t *counts, size_t begin, size_t end, uint32_t x){
+    size_t i = begin;
+#if defined(__SSE2__)
+    const __m128i run_symbol = _mm_set1_epi32((int) x);
+    for(; i + 4 <= end; i += 4){
+        __m128i block = _mm_loadu_si128((const __m128i *) (counts + i));
+        int equal = _mm_movemask_epi8(_mm_cmpeq_epi32(block, run_symbol));
+        if(equal != 0xFFFF)
+            return i + __builtin_ctz(~equal) / 4;
+    }
+#endif
+    while(i < end && counts[i] == x)
+        i++;
+    return i;
+}
+
+/**
+ * @return the first position p in [begin, end) such that counts[p, end) are all x, end if counts[end - 1] is not x
+ */
+static size_t backward_run_begin(const uint32_t *counts, size_t begin, size_t end, uint32_t x){
+    size_t i = end;
+#if defined(__SSE2__)
+    const __m128i run_symbol = _mm_set1_epi32((int) x);
+    for(; i >= begin + 4; i -= 4){
+        __m128i block = _mm_loadu_si128((const __m128i *) (counts + i - 4));
+        int different = ~_mm_movemask_epi8(_mm_cmpeq_epi32(block, run_symbol)) & 0xFFFF;
+        if(different != 0)
+            return i - 4 + (31 - __builtin_clz(different)) / 4 + 1;
+    }
+#endif
+    while(i > begin && counts[i - 1] == x)
+        i--;
+    return i;
+}
+
+/**
+ * Encode the stream positions [begin, end)
+ * @param first_segment the segment holding begin
+ * @param segment_start stream position of the first count of each segment
+ */
+static void encode_chunk(const vector<counts_segment_t> &segments, const vector<size_t> &segment_start,
+                         size_t first_segment, size_t begin, size_t end,
+                         vector<uint32_t> &symbols, vector<uint32_t> &runs){
+    bool open_run = false;
+    uint32_t symbol = 0;
+    uint32_t run = 0;
+
+    for(size_t s = first_segment; s < segments.size() && segment_start[s] < end; s++){
+        const counts_segment_t &segment = segments[s];
+        size_t from = max(begin, segment_start[s]) - segment_start[s];
+        size_t to = min(end, segment_start[s] + segment.length) - segment_start[s];
+
+        // from and to are offsets in reading order, flipped segments are read from the back
+        for(size_t i = from; i < to;){
+            size_t next;
+            uint32_t x;
+            if(segment.reversed){
+                x = segment.counts[segment.length - 1 - i];
+                next = segment.length - backward_run_begin(segment.counts, segment.length - to, segment.length - i, x);
+            } else {
+                x = segment.counts[i];
+                next = forward_run_end(segment.counts, i, to, x);
+            }
+
+            if(open_run && x == symbol)
+                run += next - i;
+            else {
+                if(open_run){
+                    symbols.push_back(symbol);
+                    runs.push_back(run);
+                }
+                open_run = true;
+                symbol = x;
+                run = next - i;
+            }
+            i = next;
+        }
+    }
+    if(open_run){
+        symbols.push_back(symbol);
+        runs.push_back(run);
+    }
+}
+
+void run_length_encode(const vector<counts_segment_t> &segments, vector<uint32_t> &symbols, vector<uint32_t> &runs,
+                       unsigned n_threads){
+    vector<size_t> segment_start(segments.size() + 1, 0);
+    for(size_t s = 0; s < segments.size(); s++)
+        segment_start[s + 1] = segment_start[s] + segments[s].length;
+    size_t n_counts = segment_start.back();
+
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    size_t n_chunks = min((size_t) n_threads, max((size_t) 1, n_counts / MIN_PARALLEL_COUNTS));
+
+    if(n_chunks == 1){
+        encode_chunk(segments, segment_start, 0, 0, n_counts, symbols, runs);
+        return;
+    }
+
+    // every chunk is encoded as if it was the whole stream
+    vector<vector<uint32_t>> chunk_symbols(n_chunks), chunk_runs(n_chunks);
+    vector<thread> threads;
+    for(size_t c = 0; c < n_chunks; c++)
+        threads.emplace_back([&, c](){
+            size_t begin = n_counts / n_chunks * c;
+            size_t end = (c + 1 == n_chunks) ? n_counts : n_counts / n_chunks * (c + 1);
+            size_t first_segment = upper_bound(segment_start.begin(), segment_start.end(), begin) - segment_start.begin() - 1;
+            encode_chunk(segments, segment_start, first_segment, begin, end, chunk_symbols[c], chunk_runs[c]);
+        });
+    for(auto &th : threads)
+        th.join();
+
+    // join runs across chunk boundaries: a run may cover whole chunks
+    vector<size_t> skip(n_chunks, 0), out_start(n_chunks, 0);
+    size_t n_runs = symbols.size();
+    size_t last = n_chunks; // chunk owning the last run so far
+    for(size_t c = 0; c < n_chunks; c++){
+        if(chunk_symbols[c].empty())
+            continue;
+        if(last != n_chunks && chunk_symbols[last].back() == chunk_symbols[c].front()){
+            chunk_runs[last].back() += chunk_runs[c].front();
+            skip[c] = 1;
+            if(chunk_symbols[c].size() == 1)
+                continue;
+        }
+        out_start[c] = n_runs;
+        n_runs += chunk_symbols[c].size() - skip[c];
+        last = c;
+    }
+
+    symbols.resize(n_runs);
+    runs.resize(n_runs);
+    threads.clear();
+    for(size_t c = 0; c < n_chunks; c++)
+        threads.emplace_back([&, c](){
+            if(chunk_symbols[c].size() <= skip[c])
+                return;
+            copy(chunk_symbols[c].begin() + (long) skip[c], chunk_symbols[c].end(), symbols.begin() + (long) out_start[c]);
+            copy(chunk_runs[c].begin() + (long) skip[c], chunk_runs[c].end(), runs.begin() + (long) out_start[c]);
+            vector<uint32_t>().swap(chunk_symbols[c]);
+            vector<uint32_t>().swap(chunk_runs[c]);
+        });
+    for(auto &th : threads)
+        th.join();
+}
+
+void run_length_encode_serial(const vector<counts_segment_t> &segments, vector<uint32_t> &symbols, vector<uint32_t> &runs){
+    bool open_run = false;
+    uint32_t symbol = 0;
+    uint32_t run = 0;
+    for(const counts_segment_t &segment : segments)
+        for(size_t i = 0; i < segment.length; i++){
+            uint32_t x = segment.reversed ? segment.counts[segment.length - 1 - i] : segment.counts[i];
+            if(open_run && x == symbol){
+                run++;
+                continue;
+            }
+            if(open_run){
+                symbols.push_back(symbol);
+                runs.push_back(run);
+            }
+            open_run = true;
+            symbol = x;
+            run = 1;
+        }
+    if(open_run){
+        symbols.push_back(symbol);
+        runs.push_back(run);
+    }
+}
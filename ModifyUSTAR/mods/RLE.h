@@ -0,0 +1,41 @@
+//
+// Parallel run-length encoding of the counts stream
+//MOD
+//
+
+#ifndef USTAR_RLE_H
+#define USTAR_RLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * A piece of the counts stream: the counts of one simplitig, possibly read backwards (flipped simplitig)
+ */
+struct counts_segment_t{
+    const uint32_t *counts;
+    size_t length;
+    bool reversed;
+};
+
+/**
+ * Run-length encode the concatenation of segments, as a serial scan would.
+ * The stream is split in chunks encoded by different threads, run boundaries are found with SIMD compares
+ * and runs crossing chunk boundaries are merged.
+ * @param segments the counts stream
+ * @param symbols the value of each run is appended here
+ * @param runs the length of each run is appended here
+ * @param n_threads number of threads (0 means one per hardware thread)
+ */
+void run_length_encode(const vector<counts_segment_t> &segments, vector<uint32_t> &symbols, vector<uint32_t> &runs,
+                       unsigned n_threads=0);
+
+/**
+ * Reference serial implementation of run_length_encode()
+ */
+void run_length_encode_serial(const vector<counts_segment_t> &segments, vector<uint32_t> &symbols, vector<uint32_t> &runs);
+
+#endif //USTAR_RLE_H
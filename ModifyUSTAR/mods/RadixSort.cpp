@@ -0,0 +1,124 @@
+//
+// Parallel LSD radix sort of simplitigs by a double key (the average count)
+//MOD
+//
+
+#include <algorithm>
+#include <thread>
+#include <cstring>
+
+#include "RadixSort.h"
+
+static const unsigned DIGIT_BITS = 11;
+static const size_t N_BUCKETS = 1u << DIGIT_BITS;
+static const unsigned N_PASSES = (64 + DIGIT_BITS - 1) / DIGIT_BITS;
+
+// below this many keys a single thread is faster
+static const size_t MIN_PARALLEL_KEYS = 1 << 16;
+
+// 12 bytes with 32 bit indices: each pass moves less memory
+#pragma pack(push, 4)
+template<typename index_t>
+struct keyed_index_t{
+    uint64_t key;
+    index_t index;
+};
+#pragma pack(pop)
+
+/**
+ * @return an integer with the order of x: the sign bit is flipped for positives, every bit for negatives
+ */
+static inline uint64_t ordered_bits(double x){
+    if(x == 0)
+        x = 0; // -0 == +0
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (1ull << 63);
+}
+
+static inline size_t digit(uint64_t key, unsigned pass){
+    return (key >> (pass * DIGIT_BITS)) & (N_BUCKETS - 1);
+}
+
+template<typename index_t>
+static void radix_sort(const vector<double> &keys, vector<size_t> &order, unsigned n_threads){
+    size_t n = order.size();
+    vector<keyed_index_t<index_t>> items(n), sorted(n);
+    vector<size_t> chunk_start(n_threads + 1);
+    for(unsigned t = 0; t <= n_threads; t++)
+        chunk_start[t] = n * t / n_threads;
+
+    // histograms[t][pass][bucket], all passes are counted at once
+    vector<vector<size_t>> histograms(n_threads, vector<size_t>(N_PASSES * N_BUCKETS, 0));
+    auto parallel = [&](auto &&work){
+        vector<thread> threads;
+        for(unsigned t = 1; t < n_threads; t++)
+            threads.emplace_back(work, t);
+        work(0);
+        for(auto &th : threads)
+            th.join();
+    };
+    parallel([&](unsigned t){
+        vector<size_t> &histogram = histograms[t];
+        for(size_t i = chunk_start[t]; i < chunk_start[t + 1]; i++){
+            uint64_t key = ordered_bits(keys[order[i]]);
+            items[i] = {key, (index_t) order[i]};
+            for(unsigned pass = 0; pass < N_PASSES; pass++)
+                histogram[pass * N_BUCKETS + digit(key, pass)]++;
+        }
+    });
+
+    vector<vector<size_t>> offsets(n_threads, vector<size_t>(N_BUCKETS));
+    bool moved = false;
+    for(unsigned pass = 0; pass < N_PASSES; pass++){
+        // a digit shared by every key doesn't move anything
+        size_t bucket = digit(items[0].key, pass), same = 0;
+        for(unsigned t = 0; t < n_threads; t++)
+            same += histograms[t][pass * N_BUCKETS + bucket];
+        if(same == n)
+            continue;
+
+        // once keys have moved the chunks hold other keys: count this digit again
+        if(moved && n_threads > 1)
+            parallel([&](unsigned t){
+                size_t *histogram = histograms[t].data() + pass * N_BUCKETS;
+                fill(histogram, histogram + N_BUCKETS, 0);
+                for(size_t i = chunk_start[t]; i < chunk_start[t + 1]; i++)
+                    histogram[digit(items[i].key, pass)]++;
+            });
+
+        // thread t writes bucket b after the lower buckets and after the previous threads' keys in b
+        size_t offset = 0;
+        for(size_t b = 0; b < N_BUCKETS; b++)
+            for(unsigned t = 0; t < n_threads; t++){
+                offsets[t][b] = offset;
+                offset += histograms[t][pass * N_BUCKETS + b];
+            }
+        parallel([&](unsigned t){
+            vector<size_t> &offset_t = offsets[t];
+            for(size_t i = chunk_start[t]; i < chunk_start[t + 1]; i++)
+                sorted[offset_t[digit(items[i].key, pass)]++] = items[i];
+        });
+        items.swap(sorted);
+        moved = true;
+    }
+
+    parallel([&](unsigned t){
+        for(size_t i = chunk_start[t]; i < chunk_start[t + 1]; i++)
+            order[i] = items[i].index;
+    });
+}
+
+void radix_sort_by_key(const vector<double> &keys, vector<size_t> &order, unsigned n_threads){
+    if(order.size() < 2)
+        return;
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    if(order.size() < MIN_PARALLEL_KEYS)
+        n_threads = 1;
+
+    if(keys.size() <= UINT32_MAX)
+        radix_sort<uint32_t>(keys, order, n_threads);
+    else
+        radix_sort<uint64_t>(keys, order, n_threads);
+}
@@ -0,0 +1,26 @@
+//
+// Parallel LSD radix sort of simplitigs by a double key (the average count)
+//MOD
+//
+
+#ifndef USTAR_RADIXSORT_H
+#define USTAR_RADIXSORT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Sort indices by their key, as stable_sort(order, keys[a] < keys[b]) would: the keys are mapped to integers with
+ * the same order (the IEEE 754 bit pattern, negatives complemented), then sorted 11 bits at a time. Digits that are
+ * the same for every key are skipped. Each pass splits the input in one chunk per thread.
+ * NaN keys are not supported.
+ * @param keys the key of each index
+ * @param order the indices to sort, sorted in place
+ * @param n_threads number of threads (0 means one per hardware thread)
+ */
+void radix_sort_by_key(const vector<double> &keys, vector<size_t> &order, unsigned n_threads=0);
+
+#endif //USTAR_RADIXSORT_H
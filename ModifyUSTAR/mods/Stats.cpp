@@ -0,0 +1,496 @@
+//
+// dBG statistics accumulated while parsing, mergeable across files and runs
+//MOD
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include "Stats.h"
+#include "DBG.h"
+#include "FastWriter.h"
+#include "MappedFile.h"
+
+// ------ Histogram ------
+
+Histogram::Histogram(){
+    buckets.resize(bucket_of(UINT64_MAX) + 1, 0);
+}
+
+size_t Histogram::bucket_of(uint64_t value) {
+    if(value < EXACT_LIMIT)
+        return value;
+    // one bucket per power of two: [64, 128) is bucket EXACT_LIMIT, [128, 256) the next one...
+    size_t log2 = 63 - __builtin_clzll(value);
+    return EXACT_LIMIT + log2 - 6;
+}
+
+uint64_t Histogram::bucket_lower_bound(size_t bucket) {
+    if(bucket < EXACT_LIMIT)
+        return bucket;
+    return 1ULL << (bucket - EXACT_LIMIT + 6);
+}
+
+void Histogram::add(uint64_t value, uint64_t times) {
+    buckets[bucket_of(value)] += times;
+    count += times;
+    sum += (double) value * (double) times;
+    sum_sq += (double) value * (double) value * (double) times;
+    min_value = min(min_value, value);
+    max_value = max(max_value, value);
+}
+
+void Histogram::merge(const Histogram &other) {
+    for(size_t b = 0; b < buckets.size(); b++)
+        buckets[b] += other.buckets[b];
+    count += other.count;
+    sum += other.sum;
+    sum_sq += other.sum_sq;
+    min_value = min(min_value, other.min_value);
+    max_value = max(max_value, other.max_value);
+}
+
+uint64_t Histogram::get_count() const {
+    return count;
+}
+
+uint64_t Histogram::get_min() const {
+    return count == 0 ? 0 : min_value;
+}
+
+uint64_t Histogram::get_max() const {
+    return max_value;
+}
+
+double Histogram::mean() const {
+    return count == 0 ? 0 : sum / (double) count;
+}
+
+double Histogram::stddev() const {
+    if(count == 0)
+        return 0;
+    double m = mean();
+    return sqrt(max(0.0, sum_sq / (double) count - m * m));
+}
+
+uint64_t Histogram::quantile(double q) const {
+    if(count == 0)
+        return 0;
+    uint64_t rank = (uint64_t) (q * (double) (count - 1));
+    uint64_t seen = 0;
+    for(size_t b = 0; b < buckets.size(); b++){
+        seen += buckets[b];
+        if(seen > rank)
+            return max(bucket_lower_bound(b), min_value);
+    }
+    return max_value;
+}
+
+void Histogram::to_json(string &json) const {
+    // {"count":4,"sum":23,"sum_sq":133,"min":5,"max":7,"buckets":[0,0,0,0,0,2,1,1]}
+    json += "{\"count\":";
+    append_number(json, count);
+    json += ",\"sum\":";
+    append_number(json, sum);
+    json += ",\"sum_sq\":";
+    append_number(json, sum_sq);
+    json += ",\"min\":";
+    append_number(json, min_value);
+    json += ",\"max\":";
+    append_number(json, max_value);
+    json += ",\"buckets\":[";
+    // trailing empty buckets are left out
+    size_t used = buckets.size();
+    while(used > 0 && buckets[used - 1] == 0)
+        used--;
+    for(size_t b = 0; b < used; b++){
+        if(b > 0)
+            json += ',';
+        append_number(json, buckets[b]);
+    }
+    json += "]}";
+}
+
+static void skip_spaces(const char *&p){
+    while(*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r')
+        p++;
+}
+
+static bool expect(const char *&p, char c){
+    skip_spaces(p);
+    if(*p != c)
+        return false;
+    p++;
+    return true;
+}
+
+static bool read_key(const char *&p, string &key){
+    if(!expect(p, '"'))
+        return false;
+    const char *end = strchr(p, '"');
+    if(end == nullptr)
+        return false;
+    key.assign(p, end - p);
+    p = end + 1;
+    return expect(p, ':');
+}
+
+static bool read_number(const char *&p, uint64_t &value){
+    skip_spaces(p);
+    char *end;
+    value = strtoull(p, &end, 10);
+    if(end == p)
+        return false;
+    p = end;
+    return true;
+}
+
+static bool read_number(const char *&p, double &value){
+    skip_spaces(p);
+    char *end;
+    value = strtod(p, &end);
+    if(end == p)
+        return false;
+    p = end;
+    return true;
+}
+
+bool Histogram::from_json(const char *&p) {
+    *this = Histogram();
+    if(!expect(p, '{'))
+        return false;
+
+    string key;
+    do{
+        if(!read_key(p, key))
+            return false;
+        bool good;
+        if(key == "count") good = read_number(p, count);
+        else if(key == "sum") good = read_number(p, sum);
+        else if(key == "sum_sq") good = read_number(p, sum_sq);
+        else if(key == "min") good = read_number(p, min_value);
+        else if(key == "max") good = read_number(p, max_value);
+        else if(key == "buckets"){
+            good = expect(p, '[');
+            skip_spaces(p);
+            for(size_t b = 0; good && *p != ']'; b++){
+                if(b > 0)
+                    good = expect(p, ',');
+                if(b >= buckets.size())
+                    good = false;
+                good = good && read_number(p, buckets[b]);
+                skip_spaces(p);
+            }
+            good = good && expect(p, ']');
+        } else
+            good = false;
+        if(!good)
+            return false;
+    }while(expect(p, ','));
+
+    return expect(p, '}');
+}
+
+// ------ ComponentTracker ------
+
+void ComponentTracker::grow(uint32_t node) {
+    if(node < parent.size())
+        return;
+    size_t old_size = parent.size();
+    parent.resize(max((size_t) node + 1, 2 * old_size));
+    iota(parent.begin() + (long) old_size, parent.end(), (uint32_t) old_size);
+}
+
+uint32_t ComponentTracker::find(uint32_t node) {
+    // path halving
+    while(parent[node] != node){
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+void ComponentTracker::add_node(uint32_t id, const node_t &node) {
+    grow(id);
+    for(const auto &arc : node.arcs){
+        grow(arc.successor);
+        uint32_t a = find(id), b = find(arc.successor);
+        if(a != b)
+            parent[max(a, b)] = min(a, b);
+    }
+}
+
+void ComponentTracker::finish(size_t n_nodes, Histogram &component_size) {
+    if(n_nodes > 0)
+        grow((uint32_t) (n_nodes - 1));
+
+    // roots have the smallest ID of their component: count members on the root
+    vector<uint32_t> sizes(n_nodes, 0);
+    for(uint32_t n = 0; n < n_nodes; n++)
+        sizes[find(n)]++;
+    for(uint32_t n = 0; n < n_nodes; n++)
+        if(sizes[n] > 0)
+            component_size.add(sizes[n]);
+
+    vector<uint32_t>().swap(parent);
+}
+
+// ------ dbg_stats_t ------
+
+void dbg_stats_t::add_node(const node_t &node) {
+    add_record(node.length, node.abundances.size(), node.average_abundance, node.arcs.size());
+    for(uint32_t ab : node.abundances)
+        kmer_abundance.add(ab);
+}
+
+void dbg_stats_t::add_record(uint32_t length, uint64_t n_node_kmers, double average_abundance, uint32_t n_node_arcs) {
+    n_nodes++;
+    n_kmers += n_node_kmers;
+    n_arcs += n_node_arcs;
+    sum_unitig_length += length;
+    sum_abundances += average_abundance * (double) n_node_kmers;
+    if(n_node_arcs == 0) n_iso++;
+
+    unitig_length.add(length);
+    node_abundance.add((uint64_t) llround(average_abundance));
+    degree.add(n_node_arcs);
+}
+
+void dbg_stats_t::merge(const dbg_stats_t &other) {
+    n_nodes += other.n_nodes;
+    n_kmers += other.n_kmers;
+    n_arcs += other.n_arcs;
+    n_iso += other.n_iso;
+    sum_unitig_length += other.sum_unitig_length;
+    sum_abundances += other.sum_abundances;
+
+    unitig_length.merge(other.unitig_length);
+    node_abundance.merge(other.node_abundance);
+    kmer_abundance.merge(other.kmer_abundance);
+    degree.merge(other.degree);
+    component_size.merge(other.component_size);
+}
+
+double dbg_stats_t::avg_unitig_len() const {
+    return (double) sum_unitig_length / (double) n_nodes;
+}
+
+double dbg_stats_t::avg_abundances() const {
+    return sum_abundances / (double) n_kmers;
+}
+
+string dbg_stats_t::to_json() const {
+    string json = "{\n  \"n_nodes\": ";
+    append_number(json, n_nodes);
+    json += ",\n  \"n_kmers\": ";
+    append_number(json, n_kmers);
+    json += ",\n  \"n_arcs\": ";
+    append_number(json, n_arcs);
+    json += ",\n  \"n_iso\": ";
+    append_number(json, n_iso);
+    json += ",\n  \"sum_unitig_length\": ";
+    append_number(json, sum_unitig_length);
+    json += ",\n  \"sum_abundances\": ";
+    append_number(json, sum_abundances);
+    json += ",\n  \"unitig_length\": ";
+    unitig_length.to_json(json);
+    json += ",\n  \"node_abundance\": ";
+    node_abundance.to_json(json);
+    json += ",\n  \"kmer_abundance\": ";
+    kmer_abundance.to_json(json);
+    json += ",\n  \"degree\": ";
+    degree.to_json(json);
+    json += ",\n  \"component_size\": ";
+    component_size.to_json(json);
+    json += "\n}\n";
+    return json;
+}
+
+bool dbg_stats_t::save_json(const string &file_name) const {
+    ofstream file(file_name);
+    file << to_json();
+    return file.good();
+}
+
+bool dbg_stats_t::load_json(const string &file_name) {
+    ifstream file(file_name);
+    if(!file.good())
+        return false;
+    stringstream content;
+    content << file.rdbuf();
+    string json = content.str();
+
+    *this = dbg_stats_t();
+    const char *p = json.c_str();
+    if(!expect(p, '{'))
+        return false;
+
+    string key;
+    do{
+        if(!read_key(p, key))
+            return false;
+        bool good;
+        if(key == "n_nodes") good = read_number(p, n_nodes);
+        else if(key == "n_kmers") good = read_number(p, n_kmers);
+        else if(key == "n_arcs") good = read_number(p, n_arcs);
+        else if(key == "n_iso") good = read_number(p, n_iso);
+        else if(key == "sum_unitig_length") good = read_number(p, sum_unitig_length);
+        else if(key == "sum_abundances") good = read_number(p, sum_abundances);
+        else if(key == "unitig_length") good = unitig_length.from_json(p);
+        else if(key == "node_abundance") good = node_abundance.from_json(p);
+        else if(key == "kmer_abundance") good = kmer_abundance.from_json(p);
+        else if(key == "degree") good = degree.from_json(p);
+        else if(key == "component_size") good = component_size.from_json(p);
+        else good = false;
+        if(!good)
+            return false;
+    }while(expect(p, ','));
+
+    return expect(p, '}');
+}
+
+// ------ QC ------
+
+/**
+ * Parse an unsigned integer
+ * @param p moved past the digits
+ * @return the number
+ */
+static uint64_t parse_uint(const char *&p, const char *end){
+    uint64_t value = 0;
+    while(p < end && *p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+    return value;
+}
+
+static bool is_blank(char c){
+    return c == ' ' || c == '\t';
+}
+
+bool qc_file(const string &file_name, uint32_t kmer_size, dbg_stats_t &stats) {
+    stats = dbg_stats_t();
+
+    MappedFile unitigs_file(file_name);
+    if(!unitigs_file.good()){
+        // an empty file has no unitigs
+        ifstream test(file_name);
+        if(test.good() && test.peek() == EOF)
+            return true;
+        cerr << "qc_file(): Can't access file " << file_name << endl;
+        return false;
+    }
+
+    const char *begin = unitigs_file.data();
+    const char *end = begin + unitigs_file.size();
+    const char *released = begin;
+    const size_t RELEASE_SIZE = 16 << 20;
+
+    const char *p = begin;
+    while(p < end){
+        const char *nl = (const char *) memchr(p, '\n', end - p);
+        const char *line_end = (nl == nullptr) ? end : nl;
+
+        // escape comments
+        if(*p == '#' || p == line_end){
+            p = line_end + 1;
+            continue;
+        }
+        if(*p != '>'){
+            cerr << "qc_file(): " << file_name << ": Bad formatted input file: no def-line found!" << endl;
+            return false;
+        }
+
+        // >25 LN:i:32 ab:Z:14 12   L:-:23:+ L:-:104831:+
+        // >SRR11905265_0 ka:f:1.0    L:-:27885434:-
+        uint64_t n_abundances = 0, sum_abundance = 0;
+        double ka = -1;
+        uint32_t n_arcs = 0;
+        bool in_abundances = false;
+        const char *t = p;
+        while(t < line_end && !is_blank(*t)) t++; // skip the ID
+        while(t < line_end){
+            while(t < line_end && is_blank(*t)) t++;
+            if(t == line_end)
+                break;
+            if(*t >= '0' && *t <= '9' && in_abundances){
+                uint64_t ab = parse_uint(t, line_end);
+                n_abundances++;
+                sum_abundance += ab;
+                stats.kmer_abundance.add(ab);
+            } else {
+                in_abundances = false;
+                if(line_end - t > 5 && memcmp(t, "ab:Z:", 5) == 0) {
+                    in_abundances = true;
+                    t += 5;
+                    continue;
+                }
+                if(line_end - t > 5 && memcmp(t, "ka:f:", 5) == 0)
+                    ka = strtod(t + 5, nullptr);
+                else if(line_end - t > 2 && t[0] == 'L' && t[1] == ':')
+                    n_arcs++;
+                while(t < line_end && !is_blank(*t)) t++;
+            }
+        }
+
+        // ------ sequence line ------
+        const char *seq = line_end + 1;
+        if(seq >= end){
+            cerr << "qc_file(): " << file_name << ": expected a sequence here!" << endl;
+            return false;
+        }
+        nl = (const char *) memchr(seq, '\n', end - seq);
+        const char *seq_end = (nl == nullptr) ? end : nl;
+        uint32_t length = seq_end - seq;
+        if(length < kmer_size){
+            cerr << "qc_file(): " << file_name << ": unitig shorter than k, make sure that kmer_size=" << kmer_size << endl;
+            return false;
+        }
+
+        if(ka >= 0){
+            // Cutterfish: the average is replicated for each k-mer, as the parser does
+            uint64_t n_kmers = length - kmer_size + 1;
+            stats.kmer_abundance.add((uint64_t) ka, n_kmers);
+            stats.add_record(length, n_kmers, ka, n_arcs);
+        } else {
+            if(n_abundances != length - kmer_size + 1){
+                cerr << "qc_file(): " << file_name << ": Bad formatted input file: wrong number of abundances!" << endl;
+                return false;
+            }
+            stats.add_record(length, n_abundances, (double) sum_abundance / (double) n_abundances, n_arcs);
+        }
+        p = seq_end + 1;
+
+        // memory doesn't grow with the file: drop the pages already scanned
+        if(p - released > (long) RELEASE_SIZE && p < end)
+            released = unitigs_file.release(p - begin);
+    }
+    return true;
+}
+
+size_t qc_files(const vector<string> &file_names, uint32_t kmer_size, vector<dbg_stats_t> &stats, unsigned n_threads) {
+    if(n_threads == 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    n_threads = (unsigned) min((size_t) n_threads, max((size_t) 1, file_names.size()));
+
+    stats.assign(file_names.size(), dbg_stats_t());
+    atomic<size_t> next_file{0}, n_failed{0};
+    auto worker = [&](){
+        for(size_t f = next_file++; f < file_names.size(); f = next_file++)
+            if(!qc_file(file_names[f], kmer_size, stats[f]))
+                n_failed++;
+    };
+
+    vector<thread> threads;
+    for(unsigned t = 1; t < n_threads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for(auto &th : threads)
+        th.join();
+
+    return n_failed;
+}
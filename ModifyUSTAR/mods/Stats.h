@@ -0,0 +1,187 @@
+//
+// dBG statistics accumulated while parsing, mergeable across files and runs
+//MOD
+//
+
+#ifndef USTAR_STATS_H
+#define USTAR_STATS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+struct node_t;
+
+/**
+ * Histogram of non-negative integers.
+ * Values below EXACT_LIMIT have their own bucket, larger values share a bucket per power of two.
+ */
+class Histogram{
+    static const uint64_t EXACT_LIMIT = 64;
+
+    vector<uint64_t> buckets;
+    uint64_t count = 0;
+    double sum = 0;
+    double sum_sq = 0;
+    uint64_t min_value = UINT64_MAX;
+    uint64_t max_value = 0;
+
+    static size_t bucket_of(uint64_t value);
+
+    static uint64_t bucket_lower_bound(size_t bucket);
+
+public:
+    Histogram();
+
+    /**
+     * Count a value
+     * @param value the value
+     * @param times how many times it occurs
+     */
+    void add(uint64_t value, uint64_t times=1);
+
+    /**
+     * Add the values of another histogram
+     * @param other the histogram to merge into this one
+     */
+    void merge(const Histogram &other);
+
+    uint64_t get_count() const;
+
+    uint64_t get_min() const;
+
+    uint64_t get_max() const;
+
+    double mean() const;
+
+    double stddev() const;
+
+    /**
+     * Estimate a quantile
+     * @param q between 0 and 1
+     * @return the lower bound of the bucket holding the q-quantile (exact below EXACT_LIMIT)
+     */
+    uint64_t quantile(double q) const;
+
+    /**
+     * Append this histogram as a JSON object
+     * @param json the object is appended here
+     */
+    void to_json(string &json) const;
+
+    /**
+     * Read a histogram written by to_json()
+     * @param p the beginning of the JSON object, moved past it
+     * @return false if the object is not well formed
+     */
+    bool from_json(const char *&p);
+};
+
+/**
+ * Tracks connected components with a union-find while arcs are parsed
+ */
+class ComponentTracker{
+    vector<uint32_t> parent;
+
+    uint32_t find(uint32_t node);
+
+    void grow(uint32_t node);
+
+public:
+    /**
+     * Join a node with its successors
+     * @param id the node ID
+     * @param node the node
+     */
+    void add_node(uint32_t id, const node_t &node);
+
+    /**
+     * Count component sizes, then release the union-find
+     * @param n_nodes the number of nodes (arcs to missing nodes don't make components)
+     * @param component_size every component size is added here
+     */
+    void finish(size_t n_nodes, Histogram &component_size);
+};
+
+struct dbg_stats_t{
+    uint64_t n_nodes = 0;
+    uint64_t n_kmers = 0;
+    uint64_t n_arcs = 0;
+    uint64_t n_iso = 0;
+    uint64_t sum_unitig_length = 0;
+    double sum_abundances = 0;
+
+    Histogram unitig_length;    // nucleotides per unitig
+    Histogram node_abundance;   // average abundance of each unitig, rounded
+    Histogram kmer_abundance;   // abundance of each k-mer
+    Histogram degree;           // arcs per unitig
+    Histogram component_size;   // unitigs per connected component
+
+    /**
+     * Account for a parsed node
+     * @param node the node
+     */
+    void add_node(const node_t &node);
+
+    /**
+     * Account for a node without building it (k-mer abundances are added to kmer_abundance by the caller)
+     * @param length the unitig length
+     * @param n_kmers the number of k-mers in the unitig
+     * @param average_abundance the average k-mer abundance
+     * @param n_arcs the number of arcs
+     */
+    void add_record(uint32_t length, uint64_t n_kmers, double average_abundance, uint32_t n_arcs);
+
+    /**
+     * Add the statistics of another graph (e.g. another file of the batch)
+     * @param other the statistics to merge into these
+     */
+    void merge(const dbg_stats_t &other);
+
+    double avg_unitig_len() const;
+
+    double avg_abundances() const;
+
+    /**
+     * @return these statistics as a JSON object
+     */
+    string to_json() const;
+
+    /**
+     * Write to_json() to a file
+     * @param file_name the JSON file
+     * @return false if the file can't be written
+     */
+    bool save_json(const string &file_name) const;
+
+    /**
+     * Read statistics written by save_json(), e.g. to merge them with this run
+     * @param file_name the JSON file
+     * @return false if the file can't be read or is not well formed
+     */
+    bool load_json(const string &file_name);
+};
+
+/**
+ * Stats-only QC: scan a BCALM2 or Cutterfish file and collect dbg_stats_t without building the dBG.
+ * Memory doesn't depend on the file size; component_size is not computed.
+ * @param file_name the unitigs file
+ * @param kmer_size the k-mer size (needed for Cutterfish k-mer counts)
+ * @param stats statistics are returned here
+ * @return false if the file can't be read or is badly formatted (the reason is printed)
+ */
+bool qc_file(const string &file_name, uint32_t kmer_size, dbg_stats_t &stats);
+
+/**
+ * Run qc_file() on many files in parallel
+ * @param file_names the unitigs files
+ * @param kmer_size the k-mer size
+ * @param stats statistics of each file are returned here, in the same order
+ * @param n_threads number of threads (0 means one per hardware thread)
+ * @return the number of files that failed
+ */
+size_t qc_files(const vector<string> &file_names, uint32_t kmer_size, vector<dbg_stats_t> &stats, unsigned n_threads=0);
+
+#endif //USTAR_STATS_H
@@ -0,0 +1,244 @@
+//
+// Push-based Encoder: simplitigs are given one at a time, as the path cover produces them
+//MOD
+//
+
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <cstdio>
+
+#include "StreamingEncoder.h"
+#include "RLE.h"
+#include "BWT.h"
+#include "RadixSort.h"
+#include "Flip.h"
+#include "BlockedCounts.h"
+#include "MappedFile.h"
+#include "DBG.h"
+
+StreamingEncoder::StreamingEncoder(const string &fasta_file_name, encoding_t encoding, bool debug)
+        : encoding(encoding), debug(debug), fasta_file_name(fasta_file_name), fasta_file(fasta_file_name) {
+    if(sorts_by_average()){
+        spill_file_name = fasta_file_name + ".unsorted";
+        spill_file = make_unique<FastWriter>(spill_file_name);
+        spill_offsets.push_back(0);
+    }
+}
+
+bool StreamingEncoder::sorts_by_average() const {
+    return encoding == encoding_t::AVG_RLE || encoding == encoding_t::AVG_FLIP_RLE;
+}
+
+bool StreamingEncoder::flips() const {
+    return encoding == encoding_t::FLIP_RLE || encoding == encoding_t::AVG_FLIP_RLE;
+}
+
+bool StreamingEncoder::choose_flip(const uint32_t *counts, size_t length) const {
+    if(symbols.empty())
+        return false;
+    uint32_t last = symbols.back();
+    return counts[0] != last && counts[length - 1] == last;
+}
+
+void StreamingEncoder::append_runs(const uint32_t *counts, size_t length, bool reversed) {
+    for(size_t i = 0; i < length; i++){
+        uint32_t count = reversed ? counts[length - 1 - i] : counts[i];
+        if(!symbols.empty() && symbols.back() == count)
+            runs.back()++;
+        else {
+            symbols.push_back(count);
+            runs.push_back(1);
+        }
+    }
+}
+
+void StreamingEncoder::write_simplitig(FastWriter &out_file, const char *simplitig, size_t length, bool flipped) {
+    string &buffer = out_file.get_buffer();
+    buffer += ">\n";
+    if(flipped){
+        rc_buffer.resize(length);
+        DBG::reverse_complement(simplitig, length, &rc_buffer[0]);
+        buffer.append(rc_buffer);
+    } else
+        buffer.append(simplitig, length);
+    buffer += '\n';
+    out_file.commit();
+}
+
+void StreamingEncoder::set_bwt_block_size(size_t block_size) {
+    bwt_block_size = block_size;
+}
+
+void StreamingEncoder::set_quantization(const Quantizer &bins) {
+    if(n_simplitigs > 0){
+        cerr << "StreamingEncoder::set_quantization(): Simplitigs were already added" << endl;
+        exit(EXIT_FAILURE);
+    }
+    quantizer = make_unique<Quantizer>(bins);
+}
+
+const quantization_error_t &StreamingEncoder::get_quantization_error() const {
+    return quantization_error;
+}
+
+void StreamingEncoder::add_simplitig(const string &simplitig, const vector<uint32_t> &exact_counts) {
+    if(finished){
+        cerr << "StreamingEncoder::add_simplitig(): The encoder is finished" << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(exact_counts.empty() || exact_counts.size() > simplitig.length()){
+        cerr << "StreamingEncoder::add_simplitig(): The counts don't match the simplitig" << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(quantizer){
+        quantized = exact_counts;
+        quantizer->quantize(quantized.data(), quantized.size(), quantization_error);
+    }
+    const vector<uint32_t> &counts = quantizer ? quantized : exact_counts;
+
+    n_simplitigs++;
+    n_kmers += counts.size();
+    simplitig_lengths.push_back((uint32_t) counts.size());
+
+    if(sorts_by_average()){
+        // everything is decided once all the averages are known
+        spill_file->get_buffer().append(simplitig);
+        spill_file->commit();
+        spill_offsets.push_back(spill_offsets.back() + simplitig.length());
+        double sum = 0;
+        for(uint32_t count : counts)
+            sum += count;
+        avg_counts.push_back(sum / (double) counts.size());
+        compacted_counts.insert(compacted_counts.end(), counts.begin(), counts.end());
+        return;
+    }
+
+    if(encoding == encoding_t::PLAIN || encoding == encoding_t::BWT){
+        write_simplitig(fasta_file, simplitig.data(), simplitig.length(), false);
+        compacted_counts.insert(compacted_counts.end(), counts.begin(), counts.end());
+        return;
+    }
+
+    bool flipped = flips() && choose_flip(counts.data(), counts.size());
+    write_simplitig(fasta_file, simplitig.data(), simplitig.length(), flipped);
+    append_runs(counts.data(), counts.size(), flipped);
+}
+
+void StreamingEncoder::finish_sorted() {
+    spill_file->close();
+
+    // by increasing average count, as Encoder::sort_by_average()
+    vector<size_t> order(n_simplitigs);
+    iota(order.begin(), order.end(), 0);
+    radix_sort_by_key(avg_counts, order);
+    vector<double>().swap(avg_counts);
+
+    vector<uint64_t> counts_offsets(n_simplitigs + 1, 0);
+    for(size_t i = 0; i < n_simplitigs; i++)
+        counts_offsets[i + 1] = counts_offsets[i] + simplitig_lengths[i];
+
+    // all the simplitigs are known here: AVG_FLIP_RLE flips them as Encoder::do_flip()
+    vector<counts_segment_t> segments;
+    segments.reserve(n_simplitigs);
+    vector<uint32_t> first(n_simplitigs), last(n_simplitigs);
+    for(size_t i = 0; i < n_simplitigs; i++){
+        const uint32_t *counts = compacted_counts.data() + counts_offsets[order[i]];
+        size_t length = simplitig_lengths[order[i]];
+        first[i] = length == 0 ? 0 : counts[0];
+        last[i] = length == 0 ? 0 : counts[length - 1];
+        segments.push_back({counts, length, false});
+    }
+    if(flips()){
+        vector<uint8_t> flipped;
+        choose_flips(first, last, flipped);
+        for(size_t i = 0; i < n_simplitigs; i++)
+            segments[i].reversed = flipped[i];
+    }
+    run_length_encode(segments, symbols, runs);
+
+    {
+        MappedFile spilled(spill_file_name, false);
+        if(n_simplitigs > 0 && !spilled.good()){
+            cerr << "StreamingEncoder::finish(): Can't map file " << spill_file_name << endl;
+            exit(EXIT_FAILURE);
+        }
+        for(size_t i = 0; i < n_simplitigs; i++){
+            size_t simplitig = order[i];
+            write_simplitig(fasta_file, spilled.data() + spill_offsets[simplitig],
+                            spill_offsets[simplitig + 1] - spill_offsets[simplitig], segments[i].reversed);
+        }
+    }
+    remove(spill_file_name.c_str());
+
+    vector<uint32_t> sorted_lengths(n_simplitigs);
+    for(size_t i = 0; i < n_simplitigs; i++)
+        sorted_lengths[i] = simplitig_lengths[order[i]];
+    simplitig_lengths.swap(sorted_lengths);
+    vector<uint32_t>().swap(compacted_counts);
+    vector<uint64_t>().swap(spill_offsets);
+}
+
+void StreamingEncoder::finish() {
+    if(finished)
+        return;
+    finished = true;
+
+    if(sorts_by_average())
+        finish_sorted();
+    else if(encoding == encoding_t::BWT){
+        // as Encoder::do_BWT()
+        vector<uint32_t> bwt;
+        bwt_transform_blocks(compacted_counts, bwt_block_size, bwt, bwt_primary_indices);
+        compacted_counts.swap(bwt);
+    }
+    fasta_file.close();
+    avg_run = runs.empty() ? 0 : (double) n_kmers / (double) runs.size();
+
+    if(debug)
+        cout << "StreamingEncoder::finish(): " << n_simplitigs << " simplitigs written to " << fasta_file_name << "\n";
+    if(quantizer)
+        cout << "Quantization: " << quantization_error.n_changed << " of " << quantization_error.n_counts
+             << " counts changed, max relative error " << quantization_error.max_relative
+             << ", mean relative error " << quantization_error.mean_relative()
+             << ", mean absolute error " << quantization_error.mean_absolute() << "\n";
+}
+
+void StreamingEncoder::to_binary_counts_file(const string &file_name, stream_codec_t codec) {
+    finish();
+
+    counts_container_t container;
+    container.encoding = (uint32_t) encoding;
+    container.quantization_bound = quantizer ? (float) quantizer->get_error_bound() : 0;
+    if(encoding == encoding_t::BWT){
+        container.bwt_block_size = bwt_block_size;
+        container.bwt_primary_indices = bwt_primary_indices;
+    }
+
+    // lend the streams to the container instead of copying them
+    symbols.swap(container.symbols);
+    runs.swap(container.runs);
+    compacted_counts.swap(container.counts);
+    write_counts_container(file_name, container, codec);
+    symbols.swap(container.symbols);
+    runs.swap(container.runs);
+    compacted_counts.swap(container.counts);
+}
+
+void StreamingEncoder::to_blocked_counts_file(const string &file_name, uint32_t block_kmers) {
+    if(encoding == encoding_t::BWT){
+        cerr << "StreamingEncoder::to_blocked_counts_file(): The BWT can't be decoded by block" << endl;
+        exit(EXIT_FAILURE);
+    }
+    finish();
+    write_blocked_counts(file_name, symbols, runs, compacted_counts, simplitig_lengths, (uint32_t) encoding, block_kmers);
+}
+
+void StreamingEncoder::print_stat() const {
+    cout << "Simplitigs: " << n_simplitigs << "\n";
+    cout << "k-mers: " << n_kmers << "\n";
+    if(!runs.empty()){
+        cout << "Runs: " << runs.size() << "\n";
+        cout << "Average run: " << avg_run << "\n";
+    }
+}
@@ -0,0 +1,138 @@
+//
+// Push-based Encoder: simplitigs are given one at a time, as the path cover produces them
+//MOD
+//
+
+#ifndef USTAR_STREAMINGENCODER_H
+#define USTAR_STREAMINGENCODER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "consts.h"
+#include "FastWriter.h"
+#include "CountsFile.h"
+#include "Quantize.h"
+
+using namespace std;
+
+/**
+ * Encode simplitigs and their counts without keeping all of them in memory.
+ * The simplitigs are written to the FASTA file as they come (reverse-complemented when flipped), and only what the
+ * encoding needs is kept: runs for RLE and FLIP_RLE, the counts stream for PLAIN and BWT. AVG_RLE and AVG_FLIP_RLE
+ * must sort the simplitigs by average count first: they keep the counts in one flat array and spill the sequences
+ * to a temporary file, which is copied to the FASTA file in sorted order by finish().
+ * AVG_FLIP_RLE flips as Encoder::do_flip(), with choose_flips(). FLIP_RLE must decide when a simplitig comes, so it is
+ * greedy: a simplitig is flipped when that extends the last run and the other way doesn't, and it may flip less
+ * than the Encoder. The BWT is the same as the Encoder's. The FASTA records have an empty definition line, which may
+ * differ from those of upstream's Encoder::to_fasta_file().
+ * ustar itself doesn't use this class yet, it's for callers that produce the simplitigs one at a time.
+ */
+class StreamingEncoder{
+    encoding_t encoding;
+    bool debug;
+    bool finished = false;
+
+    string fasta_file_name;
+    FastWriter fasta_file;
+    string spill_file_name;
+    unique_ptr<FastWriter> spill_file;     // AVG encodings only: the sequences, in input order
+    string rc_buffer;
+
+    size_t n_simplitigs = 0;
+    size_t n_kmers = 0;
+    vector<uint32_t> simplitig_lengths;     // k-mers of each simplitig, in output order once finished
+
+    vector<uint32_t> symbols;
+    vector<uint32_t> runs;
+    double avg_run = 0;
+
+    vector<uint32_t> compacted_counts;      // PLAIN, BWT, and the unsorted counts of the AVG encodings
+
+    // AVG encodings only, in input order
+    vector<uint64_t> spill_offsets;
+    vector<double> avg_counts;
+
+    size_t bwt_block_size = 0;
+    vector<uint64_t> bwt_primary_indices;
+
+    unique_ptr<Quantizer> quantizer;
+    vector<uint32_t> quantized;             // the counts of the current simplitig, quantized
+    quantization_error_t quantization_error;
+
+    bool sorts_by_average() const;
+
+    bool flips() const;
+
+    /**
+     * @return true if the counts should be appended backwards, given the last count written
+     */
+    bool choose_flip(const uint32_t *counts, size_t length) const;
+
+    /**
+     * Append counts to symbols and runs
+     */
+    void append_runs(const uint32_t *counts, size_t length, bool reversed);
+
+    /**
+     * Write a FASTA record, reverse-complemented if flipped
+     */
+    void write_simplitig(FastWriter &out_file, const char *simplitig, size_t length, bool flipped);
+
+    /**
+     * AVG encodings: sort by average count, flip, run-length encode and write the FASTA file in sorted order
+     */
+    void finish_sorted();
+
+public:
+    /**
+     * @param fasta_file_name the simplitigs are written there
+     * @param encoding how the counts are encoded
+     * @param debug print progress
+     */
+    StreamingEncoder(const string &fasta_file_name, encoding_t encoding, bool debug=false);
+
+    /**
+     * Transform the counts in independent blocks of this size (BWT only, 0 for a single block)
+     */
+    void set_bwt_block_size(size_t block_size);
+
+    /**
+     * Lossy mode: counts are replaced with their bin representatives before encoding (see Encoder::set_quantization())
+     * Must be called before the first simplitig.
+     */
+    void set_quantization(const Quantizer &bins);
+
+    const quantization_error_t &get_quantization_error() const;
+
+    /**
+     * Add the next simplitig
+     * @param simplitig its sequence
+     * @param counts the counts of its k-mers
+     */
+    void add_simplitig(const string &simplitig, const vector<uint32_t> &counts);
+
+    /**
+     * No more simplitigs: complete the encoding and close the FASTA file
+     */
+    void finish();
+
+    /**
+     * Write the encoded counts in a binary .counts container (see CountsFile.h), after finish()
+     * @param file_name the output file
+     * @param codec how streams are coded
+     */
+    void to_binary_counts_file(const string &file_name, stream_codec_t codec=stream_codec_t::RANS);
+
+    /**
+     * Write the encoded counts in a block-indexed file (see BlockedCounts.h), after finish(). Not available for BWT.
+     * @param file_name the output file
+     * @param block_kmers k-mers per block
+     */
+    void to_blocked_counts_file(const string &file_name, uint32_t block_kmers=1 << 16);
+
+    void print_stat() const;
+};
+
+#endif //USTAR_STREAMINGENCODER_H
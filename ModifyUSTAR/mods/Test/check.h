@@ -0,0 +1,20 @@
+//
+// Minimal checks for the tests of the mods: every failed check is printed, main() returns the number of failures
+//MOD
+//
+
+#ifndef USTAR_TEST_CHECK_H
+#define USTAR_TEST_CHECK_H
+
+#include <iostream>
+
+static int n_failures = 0;
+
+#define CHECK(condition) do{ \
+        if(!(condition)){ \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            n_failures++; \
+        } \
+    } while(0)
+
+#endif //USTAR_TEST_CHECK_H
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Build and run the tests of the mods, stop at the first failure
+# Usage: run_tests.sh [source directory]
+# The source directory holds the mods and USTAR's consts.h and commons.h (/USTAR/src in the container), the mods directory by default
+
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC=${1:-$(dirname "$TEST_DIR")}
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# run_test <test name> <sources from SRC>...
+run_test(){
+    name=$1
+    shift
+    sources=""
+    for source in "$@"; do
+        sources="$sources $SRC/$source"
+    done
+    g++ -O2 -std=c++17 -pthread -include cstdint -I"$SRC" "$TEST_DIR/$name.cpp" $sources -o "$BUILD/$name" || exit 1
+    (cd "$TEST_DIR" && "$BUILD/$name") || exit 1
+}
+
+run_test test_radix_sort RadixSort.cpp
+run_test test_flips Flip.cpp
+run_test test_bwt BWT.cpp
+run_test test_quantize Quantize.cpp
+run_test test_blocked BlockedCounts.cpp Entropy.cpp
+run_test test_counts_file CountsFile.cpp Entropy.cpp IntCodecs.cpp BWT.cpp
+run_test test_codecs Entropy.cpp IntCodecs.cpp
+run_test test_stats Stats.cpp DBG.cpp
+run_test test_dbg Stats.cpp DBG.cpp
@@ -0,0 +1,141 @@
+//
+// BlockedCountsReader gives back the counts written by write_blocked_counts(), and refuses corrupted files
+//MOD
+//
+
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include "check.h"
+#include "BlockedCounts.h"
+
+using namespace std;
+
+static const char *FILE_NAME = "test_blocked.tmp";
+
+// offsets in the header of the file
+static const size_t N_SIMPLITIGS_OFFSET = 32, N_BLOCKS_OFFSET = 40, LENGTHS_SIZE_OFFSET = 48;
+
+static string read_file(){
+    ifstream in(FILE_NAME, ios::binary);
+    return {istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+}
+
+static void write_file(const string &content){
+    ofstream out(FILE_NAME, ios::binary | ios::trunc);
+    out << content;
+}
+
+// the reader prints why a file is refused
+static bool opens(){
+    cerr.setstate(ios::failbit);
+    BlockedCountsReader reader(FILE_NAME);
+    cerr.clear();
+    return reader.good();
+}
+
+template<typename T>
+static string patched(string content, size_t offset, T value){
+    memcpy(&content[offset], &value, sizeof(T));
+    return content;
+}
+
+int main(){
+    mt19937_64 rng(44);
+
+    for(int trial = 0; trial < 40; trial++){
+        // simplitigs of 1 to 60 k-mers, counts with runs
+        vector<uint32_t> lengths(1 + rng() % 2000), counts;
+        for(uint32_t &length : lengths){
+            length = 1 + rng() % 60;
+            uint32_t value = 1 + rng() % 6;
+            for(uint32_t i = 0; i < length; i++){
+                if(rng() % 4 == 0)
+                    value = rng() % 10 == 0 ? (uint32_t) rng() : 1 + rng() % 6;
+                counts.push_back(value);
+            }
+        }
+        bool rle = trial % 2 == 0;
+        vector<uint32_t> symbols, runs;
+        if(rle)
+            for(uint32_t count : counts){
+                if(symbols.empty() || symbols.back() != count){
+                    symbols.push_back(count);
+                    runs.push_back(0);
+                }
+                runs.back()++;
+            }
+        uint32_t block_kmers = 1 + rng() % 5000;
+        write_blocked_counts(FILE_NAME, symbols, runs, rle ? vector<uint32_t>() : counts, lengths, 1, block_kmers,
+                             1 + trial % 3);
+
+        {
+            BlockedCountsReader reader(FILE_NAME);
+            CHECK(reader.good());
+            CHECK(reader.get_n_kmers() == counts.size());
+            CHECK(reader.get_n_simplitigs() == lengths.size());
+            CHECK(reader.get_encoding() == 1);
+            bool same = true;
+            for(int i = 0; i < 200; i++){
+                uint64_t rank = rng() % counts.size();
+                same &= reader.get_count(rank) == counts[rank];
+            }
+            CHECK(same);
+            uint64_t first = rng() % counts.size(), n = rng() % (counts.size() - first + 1);
+            vector<uint32_t> range;
+            reader.get_counts(first, n, range);
+            CHECK(equal(range.begin(), range.end(), counts.begin() + (long) first) && range.size() == n);
+            uint64_t rank = 0;
+            for(size_t s = 0; s < lengths.size(); s++){
+                if(s % 97 == 0){
+                    vector<uint32_t> simplitig_counts;
+                    reader.get_simplitig_counts(s, simplitig_counts);
+                    same &= reader.get_first_rank(s) == rank
+                            && equal(simplitig_counts.begin(), simplitig_counts.end(), counts.begin() + (long) rank)
+                            && simplitig_counts.size() == lengths[s];
+                }
+                rank += lengths[s];
+            }
+            CHECK(same);
+        }
+
+        // corrupted files are refused before anything is decoded
+        string content = read_file();
+        uint64_t n_blocks;
+        memcpy(&n_blocks, &content[N_BLOCKS_OFFSET], sizeof(n_blocks));
+        uint64_t lengths_size;
+        memcpy(&lengths_size, &content[LENGTHS_SIZE_OFFSET], sizeof(lengths_size));
+        size_t directory_offset = 56 + (lengths_size + 7) / 8 * 8;
+
+        write_file(content.substr(0, rng() % content.size()));
+        CHECK(!opens());
+        // more simplitigs than k-mers
+        write_file(patched(content, N_SIMPLITIGS_OFFSET, (uint64_t) 1 << 60));
+        CHECK(!opens());
+        // not ceil(n_kmers / block_kmers) blocks
+        write_file(patched(content, N_BLOCKS_OFFSET, n_blocks + 1));
+        CHECK(!opens());
+        // lengths past the end of the file
+        write_file(patched(content, LENGTHS_SIZE_OFFSET, UINT64_MAX - 3));
+        CHECK(!opens());
+        // a block that doesn't start at b * block_kmers, past the end of the file, or with more runs than k-mers
+        size_t b = rng() % n_blocks;
+        size_t entry_offset = directory_offset + b * sizeof(counts_block_entry_t);
+        write_file(patched(content, entry_offset, (uint64_t) b * block_kmers + 1));
+        CHECK(!opens());
+        write_file(patched(content, entry_offset + offsetof(counts_block_entry_t, offset), UINT64_MAX - 1));
+        CHECK(!opens());
+        write_file(patched(content, entry_offset + offsetof(counts_block_entry_t, n_runs), block_kmers + 1));
+        CHECK(!opens());
+    }
+    remove(FILE_NAME);
+
+    if(n_failures == 0)
+        cout << "test_blocked: ok" << endl;
+    return n_failures;
+}
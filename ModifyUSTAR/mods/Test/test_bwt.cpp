@@ -0,0 +1,81 @@
+//
+// bwt_transform() matches a naive suffix sort, bwt_transform_blocks() transforms each block alone, both invert
+//MOD
+//
+
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include "check.h"
+#include "BWT.h"
+
+using namespace std;
+
+// sort the suffixes, the virtual sentinel (the empty suffix) first
+static uint64_t naive_bwt(const vector<uint32_t> &text, vector<uint32_t> &bwt){
+    size_t n = text.size();
+    vector<size_t> suffixes(n + 1);
+    iota(suffixes.begin(), suffixes.end(), 0);
+    sort(suffixes.begin(), suffixes.end(), [&](size_t a, size_t b){
+        return lexicographical_compare(text.begin() + (long) a, text.end(), text.begin() + (long) b, text.end());
+    });
+    bwt.clear();
+    uint64_t primary_index = 0;
+    for(size_t row = 0; row <= n; row++){
+        if(suffixes[row] == 0)
+            primary_index = row;
+        else
+            bwt.push_back(text[suffixes[row] - 1]);
+    }
+    return n == 0 ? 0 : primary_index;
+}
+
+static void random_text(mt19937_64 &rng, size_t n, uint32_t n_values, vector<uint32_t> &text){
+    text.resize(n);
+    uint32_t value = 0;
+    for(uint32_t &count : text){
+        // runs, as in the counts stream
+        if(rng() % 3 == 0)
+            value = rng() % 8 == 0 ? (uint32_t) rng() : (uint32_t) (rng() % n_values);
+        count = value;
+    }
+}
+
+int main(){
+    mt19937_64 rng(42);
+    vector<uint32_t> text, bwt, expected, inverted;
+
+    for(int trial = 0; trial < 300; trial++){
+        random_text(rng, rng() % 300, 1 + trial % 5, text);
+        uint64_t primary_index = bwt_transform(text, bwt);
+        CHECK(primary_index == naive_bwt(text, expected));
+        CHECK(bwt == expected);
+        bwt_inverse(bwt, primary_index, inverted);
+        CHECK(inverted == text);
+    }
+
+    for(int trial = 0; trial < 30; trial++){
+        random_text(rng, rng() % 300000, 2 + trial % 50, text);
+        size_t block_size = trial % 3 == 0 ? 0 : 1 + rng() % 70000;
+        vector<uint64_t> primary_indices;
+        bwt_transform_blocks(text, block_size, bwt, primary_indices, 1 + trial % 4);
+        CHECK(bwt.size() == text.size());
+        bwt_inverse_blocks(bwt, block_size, primary_indices, inverted);
+        CHECK(inverted == text);
+
+        // every block is the BWT of its counts alone
+        size_t size = block_size == 0 ? max(text.size(), (size_t) 1) : block_size;
+        CHECK(primary_indices.size() == (text.size() + size - 1) / size);
+        for(size_t b = 0; b < primary_indices.size() && b < 3; b++){
+            vector<uint32_t> block(text.begin() + (long) (b * size), text.begin() + (long) min(text.size(), (b + 1) * size));
+            uint64_t primary_index = bwt_transform(block, expected);
+            CHECK(primary_indices[b] == primary_index);
+            CHECK(equal(expected.begin(), expected.end(), bwt.begin() + (long) (b * size)));
+        }
+    }
+
+    if(n_failures == 0)
+        cout << "test_bwt: ok" << endl;
+    return n_failures;
+}
@@ -0,0 +1,102 @@
+//
+// Every codec of the counts streams gives back what it coded, within the bounds used to check value counts
+//MOD
+//
+
+#include <vector>
+#include <string>
+#include <random>
+#include "check.h"
+#include "Entropy.h"
+#include "IntCodecs.h"
+
+using namespace std;
+
+typedef void (*encode_t)(const uint32_t *values, size_t n, string &out);
+typedef bool (*decode_t)(const char *data, size_t size, size_t n, uint32_t *values);
+
+struct codec_t{
+    const char *name;
+    encode_t encode;
+    decode_t decode;
+};
+
+static const codec_t CODECS[] = {{"rans", rans_encode, rans_decode}, {"varint", varint_encode, varint_decode},
+                                 {"stream-vbyte", stream_vbyte_encode, stream_vbyte_decode},
+                                 {"for", for_encode, for_decode}};
+
+/**
+ * Values of a kind: small counts with runs, any value, few bits above a large minimum, a single value
+ */
+static vector<uint32_t> make_values(int kind, size_t n, mt19937_64 &rng){
+    vector<uint32_t> values(n);
+    uint32_t value = 1;
+    for(uint32_t &x : values){
+        switch(kind){
+            case 0:
+                if(rng() % 4 == 0)
+                    value = rng() % 20 == 0 ? (uint32_t) rng() : 1 + rng() % 6;
+                x = value;
+                break;
+            case 1:
+                x = (uint32_t) (rng() >> (rng() % 64));
+                break;
+            case 2:
+                x = 3000000000u + (uint32_t) (rng() % 1000);
+                break;
+            default:
+                x = kind == 3 ? 7 : UINT32_MAX;
+        }
+    }
+    return values;
+}
+
+int main(){
+    mt19937_64 rng(48);
+    const size_t SIZES[] = {0, 1, 3, 4, 5, 127, 128, 129, 1000, 100000};
+
+    for(const codec_t &codec : CODECS){
+        bool round_trips = true, bounded = true, refuses_truncated = true, refuses_extra = true;
+        for(int kind = 0; kind < 5; kind++)
+            for(size_t n : SIZES){
+                vector<uint32_t> values = make_values(kind, n, rng), decoded(n + 1);
+                string coded;
+                codec.encode(values.data(), n, coded);
+                round_trips &= codec.decode(coded.data(), coded.size(), n, decoded.data())
+                               && equal(values.begin(), values.end(), decoded.begin());
+
+                // the bounds never refuse a count that was written
+                if(codec.encode == rans_encode)
+                    bounded &= rans_max_values(coded.data(), coded.size()) >= n;
+                else if(codec.encode == for_encode)
+                    bounded &= for_max_values(coded.size()) >= n;
+                else
+                    bounded &= coded.size() >= n;
+
+                // a payload cut short, or asked for more values than it holds
+                if(!coded.empty())
+                    refuses_truncated &= !codec.decode(coded.data(), coded.size() - 1, n, decoded.data());
+                // (LEB128 and Stream VByte spend bytes on every value; a rANS stream of a single token and the padding
+                // of the last frame of reference block can hold more values than they were given)
+                if((codec.encode == varint_encode || codec.encode == stream_vbyte_encode) && n > 0)
+                    refuses_extra &= !codec.decode(coded.data(), coded.size(), n + 1, decoded.data());
+            }
+        CHECK(round_trips);
+        CHECK(bounded);
+        CHECK(refuses_truncated);
+        CHECK(refuses_extra);
+        if(!round_trips || !bounded || !refuses_truncated || !refuses_extra)
+            cerr << "codec " << codec.name << endl;
+    }
+
+    // rANS codes a single value below 64 in no space: the number of values can't be bounded
+    vector<uint32_t> ones(1000, 1);
+    string coded;
+    rans_encode(ones.data(), ones.size(), coded);
+    CHECK(rans_max_values(coded.data(), coded.size()) == SIZE_MAX);
+    CHECK(rans_max_values(coded.data(), coded.size() / 2) == 0);
+
+    if(n_failures == 0)
+        cout << "test_codecs: ok" << endl;
+    return n_failures;
+}
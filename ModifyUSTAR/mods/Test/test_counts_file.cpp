@@ -0,0 +1,152 @@
+//
+// The binary counts container gives back what was written with every codec, and refuses value counts its payloads
+// can't hold
+//MOD
+//
+
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
+#include "check.h"
+#include "consts.h"
+#include "CountsFile.h"
+#include "BWT.h"
+
+using namespace std;
+
+static const char *FILE_NAME = "test_counts_file.tmp";
+
+static const stream_codec_t CODECS[] = {stream_codec_t::RAW, stream_codec_t::RANS, stream_codec_t::VARINT,
+                                        stream_codec_t::STREAM_VBYTE, stream_codec_t::FOR};
+
+static string read_file(){
+    ifstream in(FILE_NAME, ios::binary);
+    return {istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+}
+
+static void write_file(const string &content){
+    ofstream out(FILE_NAME, ios::binary | ios::trunc);
+    out << content;
+}
+
+// read_counts_container() prints why a file is refused
+static bool reads(counts_container_t &container){
+    cerr.setstate(ios::failbit);
+    bool good = read_counts_container(FILE_NAME, container);
+    cerr.clear();
+    return good;
+}
+
+/**
+ * Write the counts of a container with a single stream, then claim more values than the payload holds
+ */
+static void check_refused(const vector<uint32_t> &counts, stream_codec_t codec, uint64_t n_values){
+    counts_container_t container;
+    container.counts = counts;
+    write_counts_container(FILE_NAME, container, codec);
+    string content = read_file();
+    string payload;
+    if(codec == stream_codec_t::RAW)
+        payload.resize(counts.size() * sizeof(uint32_t));
+    else
+        encode_stream(counts, codec, payload);
+    // stream ID, codec, number of values, payload size, payload
+    size_t n_values_offset = content.size() - payload.size() - 2 * sizeof(uint64_t);
+    memcpy(&content[n_values_offset], &n_values, sizeof(n_values));
+    write_file(content);
+    CHECK(!reads(container));
+}
+
+int main(){
+    mt19937_64 rng(43);
+
+    for(int trial = 0; trial < 50; trial++){
+        vector<uint32_t> text(1 + rng() % 20000);
+        uint32_t value = 1;
+        for(uint32_t &count : text){
+            if(rng() % 3 == 0)
+                value = rng() % 20 == 0 ? (uint32_t) rng() : 1 + rng() % 8;
+            count = value;
+        }
+        // a stream of a single value would cost nothing in rANS
+        text.push_back(text.back() + 1);
+        stream_codec_t codec = CODECS[trial % 5];
+
+        // plain counts, runs, and the BWT of the counts cut in blocks
+        counts_container_t container, read;
+        int encoding = trial / 5 % 3;
+        if(encoding == 0){
+            container.encoding = (uint32_t) encoding_t::PLAIN;
+            container.counts = text;
+        }
+        else if(encoding == 1){
+            container.encoding = (uint32_t) encoding_t::RLE;
+            for(uint32_t count : text){
+                if(container.symbols.empty() || container.symbols.back() != count){
+                    container.symbols.push_back(count);
+                    container.runs.push_back(0);
+                }
+                container.runs.back()++;
+            }
+        }
+        else {
+            container.encoding = (uint32_t) encoding_t::BWT;
+            container.bwt_block_size = 1 + rng() % 5000;
+            bwt_transform_blocks(text, container.bwt_block_size, container.counts, container.bwt_primary_indices);
+        }
+        container.quantization_bound = trial % 2 == 0 ? 0 : 0.1f;
+
+        write_counts_container(FILE_NAME, container, codec);
+        CHECK(read_counts_container(FILE_NAME, read));
+        CHECK(read.encoding == container.encoding && read.quantization_bound == container.quantization_bound
+              && read.bwt_block_size == container.bwt_block_size
+              && read.bwt_primary_indices == container.bwt_primary_indices);
+        CHECK(read.symbols == container.symbols && read.runs == container.runs && read.counts == container.counts);
+        vector<uint32_t> counts;
+        decode_counts(read, counts);
+        CHECK(counts == text);
+
+        // a count the payload can't hold never reaches the allocation
+        check_refused(text, codec, UINT64_MAX);
+        check_refused(text, codec, (uint64_t) 1 << 40);
+
+        // nor does a number of runs that isn't the number of symbols
+        if(encoding == 1){
+            write_counts_container(FILE_NAME, container, codec);
+            string content = read_file(), runs_payload;
+            if(codec == stream_codec_t::RAW)
+                runs_payload.resize(container.runs.size() * sizeof(uint32_t));
+            else
+                encode_stream(container.runs, codec, runs_payload);
+            size_t n_runs_offset = content.size() - runs_payload.size() - 2 * sizeof(uint64_t);
+            uint64_t n_runs = container.runs.size() - 1;
+            memcpy(&content[n_runs_offset], &n_runs, sizeof(n_runs));
+            write_file(content);
+            CHECK(!reads(read));
+        }
+    }
+
+    // the runs of a single length cost nothing in rANS: they are bounded by the symbols
+    counts_container_t container;
+    container.encoding = (uint32_t) encoding_t::RLE;
+    for(uint32_t i = 0; i < 1000; i++){
+        container.symbols.push_back(i % 2);
+        container.runs.push_back(3);
+    }
+    write_counts_container(FILE_NAME, container, stream_codec_t::RANS);
+    string content = read_file(), runs_payload;
+    encode_stream(container.runs, stream_codec_t::RANS, runs_payload);
+    uint64_t n_runs = (uint64_t) 1 << 40;
+    memcpy(&content[content.size() - runs_payload.size() - 2 * sizeof(uint64_t)], &n_runs, sizeof(n_runs));
+    write_file(content);
+    CHECK(!reads(container));
+    remove(FILE_NAME);
+
+    if(n_failures == 0)
+        cout << "test_counts_file: ok" << endl;
+    return n_failures;
+}
@@ -0,0 +1,172 @@
+//
+// Arc symmetry repairs leave every arc with its reverse, node orders are permutations of the input graph
+//MOD
+//
+
+#include <vector>
+#include <string>
+#include <set>
+#include <tuple>
+#include <random>
+#include <fstream>
+#include <cstdio>
+#include "check.h"
+#include "DBG.h"
+
+using namespace std;
+
+static const char *FILE_NAME = "test_dbg.tmp.fa";
+static const uint32_t KMER_SIZE = 5;
+
+// from, forward, to, to_forward
+typedef tuple<node_idx_t, bool, node_idx_t, bool> edge_t;
+
+static edge_t reverse_edge(const edge_t &e){
+    return {get<2>(e), !get<3>(e), get<0>(e), !get<1>(e)};
+}
+
+/**
+ * Write a BCALM2 file of random unitigs with these arcs (sequences don't overlap, arcs are taken as given)
+ */
+static void write_bcalm_file(size_t n_nodes, const set<edge_t> &edges, mt19937_64 &rng){
+    vector<vector<edge_t>> arcs(n_nodes);
+    for(const edge_t &e : edges)
+        arcs[get<0>(e)].push_back(e);
+    ofstream out(FILE_NAME);
+    for(size_t n = 0; n < n_nodes; n++){
+        string unitig(KMER_SIZE + rng() % 10, 'A');
+        for(char &c : unitig)
+            c = "ACGT"[rng() % 4];
+        out << ">" << n << " LN:i:" << unitig.size() << " ab:Z:";
+        for(size_t i = 0; i + KMER_SIZE <= unitig.size(); i++)
+            out << 1 + rng() % 9 << " ";
+        for(const edge_t &e : arcs[n])
+            out << " L:" << (get<1>(e) ? "+" : "-") << ":" << get<2>(e) << ":" << (get<3>(e) ? "+" : "-");
+        out << "\n" << unitig << "\n";
+    }
+}
+
+static set<edge_t> edges_of(DBG &dbg){
+    set<edge_t> edges;
+    for(node_idx_t n = 0; n < dbg.get_n_nodes(); n++)
+        for(const arc_t &arc : dbg.get_node(n).arcs)
+            edges.insert({n, arc.forward, arc.successor, arc.to_forward});
+    return edges;
+}
+
+int main(){
+    mt19937_64 rng(39);
+
+    for(int trial = 0; trial < 30; trial++){
+        // symmetric arcs, then some of them lose their reverse
+        size_t n_nodes = 1 + rng() % 500;
+        set<edge_t> edges;
+        for(size_t a = rng() % (2 * n_nodes + 1); a > 0; a--){
+            edge_t e{(node_idx_t) (rng() % n_nodes), rng() % 2 == 0, (node_idx_t) (rng() % n_nodes), rng() % 2 == 0};
+            edges.insert(e);
+            edges.insert(reverse_edge(e));
+        }
+        for(auto it = edges.begin(); it != edges.end();)
+            it = rng() % 5 == 0 ? edges.erase(it) : next(it);
+        set<edge_t> dangling;
+        for(const edge_t &e : edges)
+            if(edges.count(reverse_edge(e)) == 0)
+                dangling.insert(e);
+        write_bcalm_file(n_nodes, edges, rng);
+
+        DBG dbg(FILE_NAME, KMER_SIZE);
+        CHECK(edges_of(dbg) == edges);
+        CHECK(dbg.verify_arc_symmetry() == dangling.size());
+
+        // checked and repaired while the graph is built
+        parse_options_t options;
+        options.check_arcs = true;
+        options.arc_repair = arc_repair_t::ADD_MISSING;
+        cerr.setstate(ios::failbit);
+        DBG repaired(FILE_NAME, KMER_SIZE, options);
+        options.arc_repair = arc_repair_t::DROP_DANGLING;
+        DBG dropped(FILE_NAME, KMER_SIZE, options);
+        cerr.clear();
+
+        set<edge_t> expected = edges;
+        for(const edge_t &e : dangling)
+            expected.insert(reverse_edge(e));
+        CHECK(edges_of(repaired) == expected);
+        CHECK(repaired.verify_arc_symmetry() == 0 && repaired.get_stats().n_arcs == expected.size());
+        expected = edges;
+        for(const edge_t &e : dangling)
+            expected.erase(e);
+        CHECK(edges_of(dropped) == expected);
+        CHECK(dropped.verify_arc_symmetry() == 0 && dropped.get_stats().n_arcs == expected.size());
+    }
+
+    const node_order_t ORDERS[] = {node_order_t::BFS, node_order_t::RCM, node_order_t::COMPONENTS};
+    for(int trial = 0; trial < 30; trial++){
+        size_t n_nodes = 1 + rng() % 500;
+        set<edge_t> edges;
+        for(size_t a = rng() % (n_nodes + 1); a > 0; a--){
+            edge_t e{(node_idx_t) (rng() % n_nodes), rng() % 2 == 0, (node_idx_t) (rng() % n_nodes), rng() % 2 == 0};
+            edges.insert(e);
+            edges.insert(reverse_edge(e));
+        }
+        write_bcalm_file(n_nodes, edges, rng);
+        DBG original(FILE_NAME, KMER_SIZE);
+
+        // the order of the graphs built by upstream's constructor
+        parse_options_t options;
+        options.node_order = ORDERS[trial % 3];
+        DBG::set_default_parse_options(options);
+        DBG reordered(FILE_NAME, KMER_SIZE);
+        DBG::set_default_parse_options(parse_options_t());
+
+        // the same unitigs and arcs under new IDs
+        vector<node_idx_t> original_ids(n_nodes);
+        bool permutation = reordered.get_n_nodes() == n_nodes, same_nodes = true;
+        vector<bool> seen(n_nodes, false);
+        for(node_idx_t n = 0; permutation && n < n_nodes; n++){
+            original_ids[n] = reordered.get_original_id(n);
+            permutation = original_ids[n] < n_nodes && !seen[original_ids[n]];
+            if(permutation){
+                seen[original_ids[n]] = true;
+                same_nodes &= reordered.get_unitig(n) == original.get_unitig(original_ids[n])
+                              && reordered.get_node(n).abundances == original.get_node(original_ids[n]).abundances;
+            }
+        }
+        CHECK(permutation);
+        if(!permutation)
+            continue;
+        CHECK(same_nodes);
+        set<edge_t> renamed;
+        for(const edge_t &e : edges_of(reordered))
+            renamed.insert({original_ids[get<0>(e)], get<1>(e), original_ids[get<2>(e)], get<3>(e)});
+        CHECK(renamed == edges);
+
+        // components are contiguous, in input order inside
+        if(options.node_order == node_order_t::COMPONENTS){
+            vector<node_idx_t> component(n_nodes);
+            for(node_idx_t n = 0; n < n_nodes; n++)
+                component[n] = n;
+            // smallest ID of the component, by propagation until nothing changes
+            for(bool changed = true; changed;){
+                changed = false;
+                for(const edge_t &e : edges_of(reordered)){
+                    node_idx_t smallest = min(component[get<0>(e)], component[get<2>(e)]);
+                    changed |= component[get<0>(e)] != smallest || component[get<2>(e)] != smallest;
+                    component[get<0>(e)] = component[get<2>(e)] = smallest;
+                }
+            }
+            bool contiguous = true;
+            for(node_idx_t n = 1; n < n_nodes; n++)
+                if(component[n] == component[n - 1])
+                    contiguous &= original_ids[n] > original_ids[n - 1];
+                else
+                    contiguous &= component[n] == n;
+            CHECK(contiguous);
+        }
+    }
+    remove(FILE_NAME);
+
+    if(n_failures == 0)
+        cout << "test_dbg: ok" << endl;
+    return n_failures;
+}
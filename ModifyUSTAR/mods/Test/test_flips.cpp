@@ -0,0 +1,71 @@
+//
+// choose_flips() leaves the fewest runs at simplitig boundaries, in parallel as serially
+//MOD
+//
+
+#include <vector>
+#include <random>
+#include "check.h"
+#include "Flip.h"
+
+using namespace std;
+
+// the fewest boundary runs over every orientation
+static size_t brute_force_runs(const vector<uint32_t> &first, const vector<uint32_t> &last){
+    size_t n = first.size(), best = n;
+    vector<uint8_t> flipped(n);
+    for(uint64_t mask = 0; mask < (1ull << n); mask++){
+        for(size_t i = 0; i < n; i++)
+            flipped[i] = (mask >> i) & 1;
+        best = min(best, count_boundary_runs(first, last, flipped));
+    }
+    return n == 0 ? 0 : best;
+}
+
+// a simplitig is flipped when that saves its boundary run
+static size_t greedy_runs(const vector<uint32_t> &first, const vector<uint32_t> &last){
+    size_t n = first.size();
+    vector<uint8_t> flipped(n, 0);
+    for(size_t i = 1; i < n; i++){
+        uint32_t previous = flipped[i - 1] ? first[i - 1] : last[i - 1];
+        flipped[i] = first[i] != previous && last[i] == previous;
+    }
+    return count_boundary_runs(first, last, flipped);
+}
+
+static void random_counts(mt19937_64 &rng, size_t n, uint32_t n_values, vector<uint32_t> &first, vector<uint32_t> &last){
+    first.resize(n);
+    last.resize(n);
+    for(size_t i = 0; i < n; i++){
+        first[i] = (uint32_t) (rng() % n_values);
+        // single count simplitigs too
+        last[i] = rng() % 4 == 0 ? first[i] : (uint32_t) (rng() % n_values);
+    }
+}
+
+int main(){
+    mt19937_64 rng(46);
+    vector<uint32_t> first, last;
+    vector<uint8_t> flipped, serial_flipped;
+
+    for(int trial = 0; trial < 300; trial++){
+        random_counts(rng, rng() % 15, 1 + trial % 4, first, last);
+        choose_flips_serial(first, last, serial_flipped);
+        choose_flips(first, last, flipped);
+        CHECK(flipped == serial_flipped);
+        CHECK(count_boundary_runs(first, last, flipped) == brute_force_runs(first, last));
+    }
+
+    for(int trial = 0; trial < 40; trial++){
+        random_counts(rng, 100000 + rng() % 200000, 2 + trial % 5, first, last);
+        choose_flips_serial(first, last, serial_flipped);
+        choose_flips(first, last, flipped, 1 + trial % 4);
+        CHECK(flipped == serial_flipped);
+        CHECK(count_boundary_runs(first, last, flipped) <= greedy_runs(first, last));
+        CHECK(count_boundary_runs(first, last, {}) >= count_boundary_runs(first, last, flipped));
+    }
+
+    if(n_failures == 0)
+        cout << "test_flips: ok" << endl;
+    return n_failures;
+}
@@ -0,0 +1,79 @@
+//
+// Quantizer keeps every count within its error bound, and bins are consistent
+//MOD
+//
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include "check.h"
+#include "Quantize.h"
+
+using namespace std;
+
+static void check_quantizer(const Quantizer &quantizer, mt19937_64 &rng){
+    double bound = quantizer.get_error_bound();
+    vector<uint32_t> counts;
+    // every small count, the direct lookup table boundary, then any count
+    for(uint32_t count = 0; count < 10000; count++)
+        counts.push_back(count);
+    for(int i = 0; i < 100000; i++)
+        counts.push_back((uint32_t) (rng() >> (rng() % 64)));
+    counts.push_back(UINT32_MAX);
+
+    uint32_t previous_count = 0, previous_q = 0;
+    bool monotone = true, within_bound = true, idempotent = true, table_matches = true;
+    for(uint32_t count : counts){
+        uint32_t q = quantizer.quantize(count);
+        if(count > 0 && fabs((double) q - count) / count > bound * (1 + 1e-12))
+            within_bound = false;
+        if(quantizer.quantize(q) != q)
+            idempotent = false;
+        if(count != 0 && quantizer.quantize_large(count) != q)
+            table_matches = false;
+        if(count >= previous_count && count < 10000 && q < previous_q)
+            monotone = false;
+        previous_count = count;
+        previous_q = q;
+    }
+    CHECK(quantizer.quantize(0) == 0);
+    CHECK(quantizer.quantize(1) == 1);
+    CHECK(within_bound);
+    CHECK(idempotent);
+    CHECK(table_matches);
+    CHECK(monotone);
+
+    // the error summary agrees with the counts
+    vector<uint32_t> quantized = counts;
+    quantization_error_t error;
+    quantizer.quantize(quantized.data(), quantized.size(), error);
+    size_t n_changed = 0;
+    double max_relative = 0;
+    for(size_t i = 0; i < counts.size(); i++){
+        CHECK(quantized[i] == quantizer.quantize(counts[i]));
+        if(quantized[i] != counts[i]){
+            n_changed++;
+            max_relative = max(max_relative, fabs((double) quantized[i] - counts[i]) / counts[i]);
+        }
+    }
+    CHECK(error.n_counts == counts.size());
+    CHECK(error.n_changed == n_changed);
+    CHECK(error.max_relative == max_relative);
+    CHECK(error.max_relative <= bound * (1 + 1e-12));
+}
+
+int main(){
+    mt19937_64 rng(50);
+    for(double bound : {0.01, 0.05, 0.1, 0.25, 0.5, 0.9})
+        check_quantizer(Quantizer::with_error_bound(bound), rng);
+    for(double base : {1.1, 1.5, 2.0, 3.0, 10.0})
+        check_quantizer(Quantizer::with_base(base), rng);
+
+    // wider bounds make fewer bins
+    CHECK(Quantizer::with_error_bound(0.1).get_n_bins() < Quantizer::with_error_bound(0.05).get_n_bins());
+    CHECK(Quantizer::with_base(2).get_n_bins() <= 33);
+
+    if(n_failures == 0)
+        cout << "test_quantize: ok" << endl;
+    return n_failures;
+}
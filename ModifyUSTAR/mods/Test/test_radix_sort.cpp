@@ -0,0 +1,51 @@
+//
+// radix_sort_by_key() gives the order of stable_sort() by average count
+//MOD
+//
+
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include "check.h"
+#include "RadixSort.h"
+
+using namespace std;
+
+static void check_order(const vector<double> &keys, unsigned n_threads){
+    vector<size_t> expected(keys.size());
+    iota(expected.begin(), expected.end(), 0);
+    vector<size_t> order = expected;
+    stable_sort(expected.begin(), expected.end(), [&](size_t a, size_t b){ return keys[a] < keys[b]; });
+    radix_sort_by_key(keys, order, n_threads);
+    CHECK(order == expected);
+}
+
+int main(){
+    mt19937_64 rng(47);
+    for(int trial = 0; trial < 200; trial++){
+        size_t n = trial < 100 ? rng() % 100 : rng() % 200000;
+        vector<double> keys(n);
+        switch(trial % 4){
+            case 0: // averages of a few small counts: many ties
+                for(double &key : keys)
+                    key = (double) (1 + rng() % 50) / (double) (1 + rng() % 4);
+                break;
+            case 1: // any positive double
+                for(double &key : keys)
+                    key = ldexp((double) (rng() >> 11), (int) (rng() % 200) - 100);
+                break;
+            case 2: // signs and zeros of both signs
+                for(double &key : keys)
+                    key = rng() % 5 == 0 ? (rng() % 2 ? 0.0 : -0.0) : ((double) (rng() % 1000) - 500) / 7;
+                break;
+            default: // one key
+                fill(keys.begin(), keys.end(), 3.5);
+        }
+        check_order(keys, 1 + trial % 4);
+    }
+    if(n_failures == 0)
+        cout << "test_radix_sort: ok" << endl;
+    return n_failures;
+}
@@ -0,0 +1,140 @@
+//
+// Histograms and dBG statistics merge and go through JSON unchanged, components match a graph search
+//MOD
+//
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <algorithm>
+#include "check.h"
+#include "DBG.h"
+
+using namespace std;
+
+static const char *JSON_FILE_NAME = "test_stats.tmp.json";
+
+static string json_of(const Histogram &histogram){
+    string json;
+    histogram.to_json(json);
+    return json;
+}
+
+/**
+ * Component sizes by a graph search, the arcs taken as undirected
+ */
+static void naive_components(const vector<node_t> &nodes, Histogram &component_size){
+    vector<vector<uint32_t>> neighbours(nodes.size());
+    for(uint32_t n = 0; n < nodes.size(); n++)
+        for(const arc_t &arc : nodes[n].arcs){
+            neighbours[n].push_back(arc.successor);
+            neighbours[arc.successor].push_back(n);
+        }
+    vector<bool> seen(nodes.size(), false);
+    for(uint32_t n = 0; n < nodes.size(); n++){
+        if(seen[n])
+            continue;
+        vector<uint32_t> stack = {n};
+        seen[n] = true;
+        uint64_t size = 0;
+        while(!stack.empty()){
+            uint32_t m = stack.back();
+            stack.pop_back();
+            size++;
+            for(uint32_t next : neighbours[m])
+                if(!seen[next]){
+                    seen[next] = true;
+                    stack.push_back(next);
+                }
+        }
+        component_size.add(size);
+    }
+}
+
+int main(){
+    mt19937_64 rng(35);
+
+    // every value below 64 has its own bucket, larger ones one per power of two
+    // (below 2^19, the sums of squares are exact in any order)
+    Histogram histogram, low, high;
+    vector<uint64_t> values;
+    for(int i = 0; i < 10000; i++)
+        values.push_back(i % 3 == 0 ? rng() % 64 : rng() >> (45 + rng() % 19));
+    for(size_t i = 0; i < values.size(); i++){
+        histogram.add(values[i]);
+        (i % 2 == 0 ? low : high).add(values[i]);
+    }
+    CHECK(histogram.get_count() == values.size());
+    CHECK(histogram.get_min() == *min_element(values.begin(), values.end()));
+    CHECK(histogram.get_max() == *max_element(values.begin(), values.end()));
+    Histogram small;
+    for(uint64_t v = 1; v <= 9; v++)
+        small.add(v, v == 5 ? 3 : 1);
+    CHECK(small.get_count() == 11 && small.quantile(0.5) == 5 && small.quantile(0) == 1 && small.quantile(1) == 9);
+    CHECK(small.mean() == 5);
+
+    // merging the halves gives the whole, and JSON gives back the histogram
+    low.merge(high);
+    CHECK(json_of(low) == json_of(histogram));
+    string json = json_of(histogram);
+    const char *p = json.c_str();
+    Histogram read;
+    CHECK(read.from_json(p) && *p == '\0');
+    CHECK(json_of(read) == json);
+    p = "{\"count\":3,\"sum\":";
+    CHECK(!read.from_json(p));
+
+    // components tracked while arcs are read are those of a graph search
+    for(int trial = 0; trial < 20; trial++){
+        vector<node_t> nodes(1 + rng() % 3000);
+        for(node_t &node : nodes){
+            size_t n_arcs = rng() % 3;
+            for(size_t a = 0; a < n_arcs; a++)
+                node.arcs.push_back({(node_idx_t) (rng() % nodes.size()), rng() % 2 == 0, rng() % 2 == 0});
+        }
+        ComponentTracker components;
+        for(uint32_t n = 0; n < nodes.size(); n++)
+            components.add_node(n, nodes[n]);
+        Histogram tracked, expected;
+        components.finish(nodes.size(), tracked);
+        naive_components(nodes, expected);
+        CHECK(json_of(tracked) == json_of(expected));
+    }
+
+    // the statistics of a graph are written by the options of upstream's constructor and read back unchanged
+    parse_options_t options;
+    options.stats_json_file_name = JSON_FILE_NAME;
+    DBG::set_default_parse_options(options);
+    DBG dbg("Manual_test_standard.unitigs.fa", 3);
+    DBG::set_default_parse_options(parse_options_t());
+    const dbg_stats_t &stats = dbg.get_stats();
+    CHECK(stats.n_nodes == dbg.get_n_nodes() && stats.unitig_length.get_count() == stats.n_nodes);
+    CHECK(stats.kmer_abundance.get_count() == stats.n_kmers);
+    dbg_stats_t loaded;
+    CHECK(loaded.load_json(JSON_FILE_NAME));
+    CHECK(loaded.to_json() == stats.to_json());
+
+    // merged statistics add up
+    loaded.merge(stats);
+    CHECK(loaded.n_nodes == 2 * stats.n_nodes && loaded.n_kmers == 2 * stats.n_kmers
+          && loaded.degree.get_count() == 2 * stats.degree.get_count());
+
+    // QC finds the statistics of the graph without building it, components aside, in both formats
+    vector<string> files = {"Manual_test_standard.unitigs.fa", "Manual_test_alternative.unitigs.fa", "missing.unitigs.fa"};
+    vector<dbg_stats_t> qc_stats;
+    cerr.setstate(ios::failbit);
+    CHECK(qc_files(files, 3, qc_stats, 2) == 1);
+    cerr.clear();
+    for(size_t f = 0; f < 2; f++){
+        DBG graph(files[f], 3);
+        dbg_stats_t expected = graph.get_stats();
+        expected.component_size = Histogram();
+        CHECK(qc_stats[f].to_json() == expected.to_json());
+    }
+    remove(JSON_FILE_NAME);
+
+    if(n_failures == 0)
+        cout << "test_stats: ok" << endl;
+    return n_failures;
+}
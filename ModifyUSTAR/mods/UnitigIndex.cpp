@@ -0,0 +1,198 @@
+//
+// .fai-like side index for random access into BCALM2/Cutterfish unitig files
+//MOD
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <sys/stat.h>
+#include "UnitigIndex.h"
+
+// "UIDX" + version
+static const uint32_t UIDX_MAGIC = 0x58444955;
+static const uint32_t UIDX_VERSION = 2; // 1 had no modification time
+
+/**
+ * @return the modification time of a file in nanoseconds, 0 if it can't be read
+ */
+static uint64_t modification_time(const string &file_name){
+    struct stat st{};
+    if(stat(file_name.c_str(), &st) != 0)
+        return 0;
+    return (uint64_t) st.st_mtim.tv_sec * 1000000000 + (uint64_t) st.st_mtim.tv_nsec;
+}
+
+UnitigIndex::UnitigIndex(const string &unitigs_file_name, bool rebuild) : unitigs_file_name(unitigs_file_name), unitigs_file(unitigs_file_name){
+    if(!unitigs_file.good()){
+        // empty files are never mapped: they have an empty index
+        struct stat st{};
+        if(stat(unitigs_file_name.c_str(), &st) == 0 && st.st_size == 0)
+            return;
+        cerr << "UnitigIndex(): Can't map file " << unitigs_file_name << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    string index_name = index_file_name(unitigs_file_name);
+    if(rebuild || !load(index_name)){
+        build();
+        if(!save(index_name))
+            cerr << "UnitigIndex(): Can't write " << index_name << ", the index is kept in memory only" << endl;
+    }
+
+    // from now on records are read at random
+    unitigs_file.advise(false);
+}
+
+string UnitigIndex::index_file_name(const string &unitigs_file_name) {
+    return unitigs_file_name + ".uidx";
+}
+
+void UnitigIndex::build() {
+    const char *begin = unitigs_file.data();
+    const char *end = begin + unitigs_file.size();
+
+    entries.clear();
+    const char *p = begin;
+    while(p < end){
+        const char *nl = (const char *) memchr(p, '\n', end - p);
+        const char *line_end = (nl == nullptr) ? end : nl;
+
+        // escape comments and anything that is not a definition line
+        if(*p != '>'){
+            p = line_end + 1;
+            continue;
+        }
+
+        unitig_index_entry_t entry{};
+        entry.offset = p - begin;
+        entry.header_length = line_end - p;
+
+        // count arcs: >25 LN:i:32 ab:Z:14 12   L:-:23:+ L:-:104831:+
+        for(const char *tag = p; (tag = (const char *) memmem(tag, line_end - tag, " L:", 3)) != nullptr; tag += 3)
+            entry.n_arcs++;
+
+        // sequence line
+        const char *seq = line_end + 1;
+        if(seq >= end){
+            cerr << "UnitigIndex::build(): expected a sequence here!" << endl;
+            exit(EXIT_FAILURE);
+        }
+        nl = (const char *) memchr(seq, '\n', end - seq);
+        const char *seq_end = (nl == nullptr) ? end : nl;
+        entry.length = seq_end - seq;
+
+        entries.push_back(entry);
+        p = seq_end + 1;
+    }
+}
+
+bool UnitigIndex::load(const string &index_file_name) {
+    ifstream index_file(index_file_name, ios::binary);
+    if(!index_file.good())
+        return false;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t file_size = 0, mtime = 0, n_entries = 0;
+    index_file.read((char *) &magic, sizeof(magic));
+    index_file.read((char *) &version, sizeof(version));
+    index_file.read((char *) &file_size, sizeof(file_size));
+    index_file.read((char *) &mtime, sizeof(mtime));
+    index_file.read((char *) &n_entries, sizeof(n_entries));
+
+    // a stale index is rebuilt: the unitigs file changed size, or was written again
+    if(!index_file.good() || magic != UIDX_MAGIC || version != UIDX_VERSION || file_size != unitigs_file.size()
+       || mtime != modification_time(unitigs_file_name))
+        return false;
+
+    // so is a truncated or corrupt one: the entries must fill the rest of the file exactly
+    streamoff header_end = index_file.tellg();
+    index_file.seekg(0, ios::end);
+    uint64_t entries_size = (uint64_t) (index_file.tellg() - header_end);
+    index_file.seekg(header_end);
+    if(!index_file.good() || n_entries > entries_size / sizeof(unitig_index_entry_t)
+       || n_entries * sizeof(unitig_index_entry_t) != entries_size)
+        return false;
+
+    entries.resize(n_entries);
+    index_file.read((char *) entries.data(), (streamsize) (n_entries * sizeof(unitig_index_entry_t)));
+    if(!index_file.good()) {
+        entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool UnitigIndex::save(const string &index_file_name) {
+    ofstream index_file(index_file_name, ios::binary | ios::trunc);
+    if(!index_file.good())
+        return false;
+
+    uint64_t file_size = unitigs_file.size();
+    uint64_t mtime = modification_time(unitigs_file_name);
+    uint64_t n_entries = entries.size();
+    index_file.write((const char *) &UIDX_MAGIC, sizeof(UIDX_MAGIC));
+    index_file.write((const char *) &UIDX_VERSION, sizeof(UIDX_VERSION));
+    index_file.write((const char *) &file_size, sizeof(file_size));
+    index_file.write((const char *) &mtime, sizeof(mtime));
+    index_file.write((const char *) &n_entries, sizeof(n_entries));
+    index_file.write((const char *) entries.data(), (streamsize) (n_entries * sizeof(unitig_index_entry_t)));
+    return index_file.good();
+}
+
+size_t UnitigIndex::size() const {
+    return entries.size();
+}
+
+const unitig_index_entry_t &UnitigIndex::get_entry(size_t node) const {
+    return entries.at(node);
+}
+
+string_view UnitigIndex::get_header(size_t node) const {
+    const unitig_index_entry_t &entry = entries.at(node);
+    return {unitigs_file.data() + entry.offset, entry.header_length};
+}
+
+string_view UnitigIndex::get_sequence(size_t node) const {
+    const unitig_index_entry_t &entry = entries.at(node);
+    return {unitigs_file.data() + entry.offset + entry.header_length + 1, entry.length};
+}
+
+void UnitigIndex::get_abundances(size_t node, uint32_t kmer_size, vector<uint32_t> &abundances) const {
+    abundances.clear();
+    string_view header = get_header(node);
+    const unitig_index_entry_t &entry = entries.at(node);
+
+    // Cutterfish: >SRR11905265_0 ka:f:1.0    L:-:27885434:-
+    size_t pos = header.find(" ka:f:");
+    if(pos != string_view::npos){
+        if(entry.length < kmer_size){
+            cerr << "UnitigIndex::get_abundances(): record " << node << " is shorter than k" << endl;
+            exit(EXIT_FAILURE);
+        }
+        double average = strtod(header.data() + pos + 6, nullptr);
+        abundances.assign(entry.length - kmer_size + 1, (uint32_t) average);
+        return;
+    }
+
+    // BCALM2: >25 LN:i:32 ab:Z:14 12   L:-:23:+
+    pos = header.find(" ab:Z:");
+    if(pos == string_view::npos){
+        cerr << "UnitigIndex::get_abundances(): no abundances in record " << node << endl;
+        exit(EXIT_FAILURE);
+    }
+    const char *p = header.data() + pos + 6;
+    const char *header_end = header.data() + header.size();
+    while(p < header_end){
+        while(p < header_end && *p == ' ') p++;
+        if(p == header_end || *p == 'L')
+            break;
+        char *next;
+        uint32_t abundance = (uint32_t) strtoul(p, &next, 10);
+        // another tag or a stray character ends the abundances
+        if(next == p)
+            break;
+        abundances.push_back(abundance);
+        p = next;
+    }
+}
@@ -0,0 +1,96 @@
+//
+// .fai-like side index for random access into BCALM2/Cutterfish unitig files
+//MOD
+//
+
+#ifndef USTAR_UNITIGINDEX_H
+#define USTAR_UNITIGINDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.h"
+
+using namespace std;
+
+struct unitig_index_entry_t{
+    uint64_t offset;        // offset of the '>' of the definition line
+    uint32_t header_length; // definition line length, '\n' excluded
+    uint32_t length;        // sequence length
+    uint32_t n_arcs;        // number of L: tags
+};
+
+class UnitigIndex{
+    string unitigs_file_name;
+    MappedFile unitigs_file;
+    vector<unitig_index_entry_t> entries;
+
+    /**
+     * Scan the unitigs file once and fill entries
+     */
+    void build();
+
+    /**
+     * Load the index file
+     * @param index_file_name the index file
+     * @return false if the index is missing or doesn't match the unitigs file
+     */
+    bool load(const string &index_file_name);
+
+    /**
+     * Write the index file
+     * @param index_file_name the index file
+     * @return false if the file can't be written
+     */
+    bool save(const string &index_file_name);
+
+public:
+    /**
+     * Open the index of a unitigs file, building and saving it next to the input (<file>.uidx) when needed.
+     * An empty file has an empty index.
+     * @param unitigs_file_name a BCALM2 or Cutterfish file
+     * @param rebuild ignore any existing index file
+     */
+    explicit UnitigIndex(const string &unitigs_file_name, bool rebuild=false);
+
+    /**
+     * @return the index file name of a unitigs file
+     */
+    static string index_file_name(const string &unitigs_file_name);
+
+    /**
+     * @return the number of records
+     */
+    size_t size() const;
+
+    /**
+     * @param node the node ID
+     * @return the index entry of node
+     */
+    const unitig_index_entry_t &get_entry(size_t node) const;
+
+    /**
+     * Slice the definition line of a node out of the mapped file
+     * @param node the node ID
+     * @return the definition line, '>' included
+     */
+    string_view get_header(size_t node) const;
+
+    /**
+     * Slice the sequence of a node out of the mapped file
+     * @param node the node ID
+     * @return the unitig
+     */
+    string_view get_sequence(size_t node) const;
+
+    /**
+     * Parse the abundances of a node from its definition line
+     * @param node the node ID
+     * @param kmer_size the k-mer size (Cutterfish averages are replicated for each k-mer)
+     * @param abundances abundances are returned here
+     */
+    void get_abundances(size_t node, uint32_t kmer_size, vector<uint32_t> &abundances) const;
+};
+
+#endif //USTAR_UNITIGINDEX_H